@@ -0,0 +1,704 @@
+// Runs the MKint pipeline over many bitcode (or textual IR) files at once, so that calls across translation units
+// are analyzed with their definitions instead of as opaque declarations.
+
+#include "log.hpp"
+#include "summary.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Demangle/Demangle.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticPrinter.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/ModuleSummaryIndex.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/PassPlugin.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/ToolOutputFile.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+// defined by the pass itself (mkint.cpp), which is linked into this tool.
+extern "C" PassPluginLibraryInfo llvmGetPassPluginInfo();
+
+// `@file` arguments are expanded by the command line parser, so inputs can also come from response files.
+static cl::list<std::string> s_inputs(cl::Positional, cl::desc("<.bc/.ll files or directories>"), cl::OneOrMore);
+static cl::opt<bool> s_separate("separate",
+    cl::desc("Analyze every input as a module of its own instead of linking them into one"), cl::init(false));
+static cl::opt<bool> s_thin("thin",
+    cl::desc("Analyze every input as a module of its own, with a whole-program summary merged from all of them"),
+    cl::init(false));
+static cl::opt<unsigned> s_rounds("rounds", cl::desc("Maximum summary rounds of -thin before the final analysis"),
+    cl::init(8));
+static cl::opt<std::string> s_summary_dir("summary-dir",
+    cl::desc("Keep the summaries of -thin in this directory (default: a temporary one)"), cl::value_desc("dir"),
+    cl::init(""));
+static cl::opt<unsigned> s_jobs("j",
+    cl::desc("Threads parsing and verifying modules ahead of the analysis with -separate or -thin (default: all cores)"),
+    cl::init(0));
+static cl::opt<unsigned> s_in_flight("in-flight",
+    cl::desc("Maximum modules loaded ahead of the analysis with -separate or -thin (default: twice -j)"), cl::init(0));
+static cl::opt<bool> s_lazy("lazy",
+    cl::desc("With -separate or -thin, only materialize the bitcode function bodies reachable from or calling taint sources"),
+    cl::init(true));
+static cl::opt<std::string> s_output("o", cl::desc("Write the annotated linked module to this file"),
+    cl::value_desc("file"), cl::init(""));
+static cl::opt<bool> s_text("S", cl::desc("Write the output as textual IR"), cl::init(false));
+
+namespace {
+
+struct run_stats {
+    double load = 0;
+    double link = 0;
+    double summary = 0;
+    double analysis = 0;
+    size_t n_failed = 0;
+    size_t n_findings = 0;
+    size_t n_skipped = 0; // function bodies never materialized.
+    size_t n_dropped = 0; // function bodies materialized, then dropped.
+    std::vector<std::pair<double, std::string>> slowest; // analysis time of each module analyzed on its own.
+};
+
+double ms_since(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void collect(StringRef input, std::vector<std::string>& files)
+{
+    if (!sys::fs::is_directory(input)) {
+        files.push_back(input.str());
+        return;
+    }
+
+    std::error_code ec;
+    for (sys::fs::recursive_directory_iterator it(input, ec), end; it != end && !ec; it.increment(ec)) {
+        const StringRef path = it->path();
+        if (path.endswith(".bc") || path.endswith(".ll"))
+            files.push_back(path.str());
+    }
+    if (ec)
+        errs() << "cannot read " << input << ": " << ec.message() << '\n';
+}
+
+struct diag_state {
+    bool has_error = false;
+    std::string log; // printed by the main thread, so that the messages of modules loaded in parallel do not mix.
+};
+
+// errors are reported and the offending input skipped, rather than exiting as the default handler does.
+void diagnose(const DiagnosticInfo& info, void* state)
+{
+    auto diag = static_cast<diag_state*>(state);
+    raw_string_ostream os(diag->log);
+    DiagnosticPrinterRawOStream printer(os);
+    info.print(printer);
+    os << '\n';
+    if (info.getSeverity() == DS_Error)
+        diag->has_error = true;
+}
+
+// Bugs are marked as `!mkint.err` metadata by the pass; one line per marked instruction.
+size_t print_findings(const Module& M, StringRef origin)
+{
+    size_t n = 0;
+    for (const auto& F : M) {
+        for (const auto& inst : instructions(F)) {
+            const MDNode* md = inst.getMetadata("mkint.err");
+            if (!md)
+                continue;
+
+            ++n;
+            outs() << origin << ": " << F.getName() << ": ";
+            if (md->getNumOperands() > 0) {
+                if (const auto str = dyn_cast<MDString>(md->getOperand(0)))
+                    outs() << str->getString();
+            }
+            outs() << ":" << inst << '\n';
+        }
+    }
+    outs().flush();
+    return n;
+}
+
+class pipeline {
+public:
+    pipeline()
+    {
+        llvmGetPassPluginInfo().RegisterPassBuilderCallbacks(m_pb);
+        m_pb.registerModuleAnalyses(m_mam);
+        m_pb.registerCGSCCAnalyses(m_cgam);
+        m_pb.registerFunctionAnalyses(m_fam);
+        m_pb.registerLoopAnalyses(m_lam);
+        m_pb.crossRegisterProxies(m_lam, m_fam, m_cgam, m_mam);
+        if (auto err = m_pb.parsePassPipeline(m_mpm, "mkint-pass"))
+            report_fatal_error(std::move(err));
+    }
+
+    void run(Module& M)
+    {
+        m_mpm.run(M, m_mam);
+        // the module may be freed next: no cached analysis may outlive it.
+        m_mam.clear();
+    }
+
+private:
+    PassBuilder m_pb;
+    LoopAnalysisManager m_lam;
+    FunctionAnalysisManager m_fam;
+    CGSCCAnalysisManager m_cgam;
+    ModuleAnalysisManager m_mam;
+    ModulePassManager m_mpm;
+}; // class pipeline
+
+std::unique_ptr<Module> load(StringRef path, LLVMContext& ctx, bool lazy, diag_state& diag)
+{
+    SMDiagnostic err;
+    auto M = lazy ? getLazyIRFileModule(path, err, ctx) : parseIRFile(path, err, ctx);
+    if (!M) {
+        raw_string_ostream os(diag.log);
+        err.print("mkint-driver", os);
+    }
+    return M;
+}
+
+bool broken(const Module& M, StringRef origin, diag_state& diag)
+{
+    std::string msg;
+    raw_string_ostream os(msg);
+    if (!verifyModule(M, &os))
+        return false;
+    diag.log += ("skipping invalid module " + origin + ": " + os.str() + "\n").str();
+    return true;
+}
+
+// the same taint sources as the pass.
+bool is_taint_src(StringRef name)
+{
+    const std::string demangled = demangle(name.str());
+    return StringRef(demangled).startswith("sys_") || StringRef(demangled).startswith("__mkint_ann_");
+}
+
+// Functions referenced by `c`, e.g. the function pointers of an operations table.
+void referenced_functions(const Constant* c, SmallPtrSetImpl<const Constant*>& visited, std::vector<Function*>& out)
+{
+    if (!visited.insert(c).second)
+        return;
+    if (auto F = dyn_cast<Function>(c)) {
+        out.push_back(const_cast<Function*>(F));
+        return;
+    }
+    if (auto GV = dyn_cast<GlobalVariable>(c)) {
+        if (GV->hasInitializer())
+            referenced_functions(GV->getInitializer(), visited, out);
+        return;
+    }
+    for (const auto& op : c->operands()) {
+        if (auto opc = dyn_cast<Constant>(op))
+            referenced_functions(opc, visited, out);
+    }
+}
+
+// The module summary index written into the bitcode (by `-flto=thin` or `opt -module-summary`), or null if there is
+// none.
+std::unique_ptr<ModuleSummaryIndex> summary_index(MemoryBufferRef buf)
+{
+    auto info = getBitcodeLTOInfo(buf);
+    if (!info) {
+        consumeError(info.takeError());
+        return nullptr;
+    }
+    if (!info->HasSummary)
+        return nullptr;
+
+    auto index = getModuleSummaryIndex(buf);
+    if (!index) {
+        consumeError(index.takeError());
+        return nullptr;
+    }
+    return std::move(*index);
+}
+
+// Functions of `M` calling or referring to a taint source, transitively, from the call and reference edges of its
+// summary index: no body is read to find them.
+std::vector<Function*> callers_of_sources(Module& M, const ModuleSummaryIndex& index)
+{
+    DenseMap<GlobalValue::GUID, std::vector<GlobalValue::GUID>> callers;
+    for (const auto& [guid, info] : index) {
+        for (const auto& summary : info.SummaryList) {
+            const auto fs = dyn_cast<FunctionSummary>(summary.get());
+            if (!fs)
+                continue;
+            for (const auto& [callee, _] : fs->calls())
+                callers[callee.getGUID()].push_back(guid);
+            for (const auto& ref : fs->refs())
+                callers[ref.getGUID()].push_back(guid);
+        }
+    }
+
+    DenseMap<GlobalValue::GUID, Function*> by_guid;
+    std::vector<GlobalValue::GUID> worklist;
+    DenseSet<GlobalValue::GUID> seen;
+    for (auto& F : M) {
+        by_guid[F.getGUID()] = &F;
+        if (is_taint_src(F.getName()) && seen.insert(F.getGUID()).second)
+            worklist.push_back(F.getGUID());
+    }
+
+    std::vector<Function*> out;
+    while (!worklist.empty()) {
+        const auto guid = worklist.back();
+        worklist.pop_back();
+        for (const auto caller : callers.lookup(guid)) {
+            if (!seen.insert(caller).second)
+                continue;
+            worklist.push_back(caller);
+            if (auto F = by_guid.lookup(caller))
+                out.push_back(F);
+        }
+    }
+    return out;
+}
+
+// Reads a bitcode input lazily and only materializes the bodies reachable from the taint sources, their (transitive)
+// callers and `roots`, through calls and references to functions (also in the initializers of globals); the other
+// functions become declarations. Functions only reached through the memory of globals are not analyzed then.
+// `n_skipped` counts the bodies never read and `n_dropped` those read and then dropped.
+std::unique_ptr<Module> load_reachable(StringRef path, LLVMContext& ctx, diag_state& diag,
+    const std::set<std::string>& roots, size_t& n_skipped, size_t& n_dropped)
+{
+    if (!s_lazy || !path.endswith(".bc")) // textual IR is parsed whole anyway.
+        return load(path, ctx, false, diag);
+
+    auto buf = MemoryBuffer::getFile(path);
+    if (!buf) {
+        diag.log += ("cannot read " + path + ": " + buf.getError().message() + "\n").str();
+        return nullptr;
+    }
+    const auto index = summary_index((*buf)->getMemBufferRef());
+    SMDiagnostic err;
+    auto M = getLazyIRModule(std::move(*buf), err, ctx);
+    if (!M) {
+        raw_string_ostream os(diag.log);
+        err.print("mkint-driver", os);
+        return nullptr;
+    }
+
+    std::vector<Function*> worklist;
+    SmallPtrSet<const Constant*, 32> visited;
+    for (auto& F : *M) {
+        if (is_taint_src(F.getName()) || roots.count(F.getName().str())) {
+            visited.insert(&F);
+            worklist.push_back(&F);
+        }
+    }
+
+    // the callers of a source decide its return sink and the ranges of its callbacks. They are found from the summary
+    // index if the bitcode has one. Otherwise a call is only seen once the body making it is materialized: a module
+    // referring to a source is then read whole, and the bodies neither reachable from a source nor calling one are
+    // dropped afterwards.
+    const bool has_sources = llvm::any_of(*M, [](const Function& F) { return is_taint_src(F.getName()); });
+    if (has_sources && index) {
+        for (auto F : callers_of_sources(*M, *index)) {
+            if (visited.insert(F).second)
+                worklist.push_back(F);
+        }
+    } else if (has_sources) {
+        if (auto err = M->materializeAll()) {
+            diag.log += path.str() + ": " + toString(std::move(err)) + "\n";
+            return nullptr;
+        }
+
+        std::vector<Function*> called(worklist.begin(), worklist.end());
+        while (!called.empty()) {
+            auto F = called.back();
+            called.pop_back();
+            for (const auto user : F->users()) {
+                if (auto inst = dyn_cast<Instruction>(user); inst && visited.insert(inst->getFunction()).second) {
+                    worklist.push_back(inst->getFunction());
+                    called.push_back(inst->getFunction());
+                }
+            }
+        }
+    }
+
+    while (!worklist.empty()) {
+        auto F = worklist.back();
+        worklist.pop_back();
+        if (auto err = F->materialize()) {
+            diag.log += path.str() + ": " + toString(std::move(err)) + "\n";
+            return nullptr;
+        }
+
+        for (const auto& inst : instructions(*F)) {
+            for (const auto& op : inst.operands()) {
+                if (auto c = dyn_cast<Constant>(op))
+                    referenced_functions(c, visited, worklist);
+            }
+        }
+    }
+
+    for (auto& F : *M) {
+        if (!F.isDeclaration() && !visited.count(&F)) {
+            if (F.isMaterializable())
+                ++n_skipped;
+            else
+                ++n_dropped;
+            F.deleteBody();
+            F.setComdat(nullptr);
+        }
+    }
+    if (auto err = M->materializeAll()) {
+        diag.log += path.str() + ": " + toString(std::move(err)) + "\n";
+        return nullptr;
+    }
+    return M;
+}
+
+// A module parsed and verified in a context of its own; `module` is null if it could not be loaded.
+struct loaded_module {
+    LLVMContext ctx;
+    diag_state diag;
+    std::unique_ptr<Module> module;
+    size_t n_skipped = 0;
+    size_t n_dropped = 0;
+    double ms = 0;
+};
+
+// Loads the inputs in order on a pool of threads, ahead of the (single-threaded) analysis. At most `in_flight`
+// modules are loaded but not taken yet, which bounds the memory.
+class prefetcher {
+public:
+    prefetcher(const std::vector<std::string>& files, const std::set<std::string>& roots, unsigned n_threads,
+        unsigned in_flight)
+        : m_files(files)
+        , m_roots(roots)
+        , m_slots(files.size())
+        , m_in_flight(std::max(1u, in_flight))
+    {
+        for (unsigned i = 0; i < std::max(1u, n_threads); ++i)
+            m_threads.emplace_back([this] { work(); });
+    }
+
+    prefetcher(const prefetcher&) = delete;
+    prefetcher& operator=(const prefetcher&) = delete;
+
+    ~prefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto& t : m_threads)
+            t.join();
+    }
+
+    // the inputs must be taken in order.
+    std::unique_ptr<loaded_module> take(size_t i)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this, i] { return m_slots[i] != nullptr; });
+        auto out = std::move(m_slots[i]);
+        m_n_taken = i + 1;
+        lock.unlock();
+        m_cv.notify_all();
+        return out;
+    }
+
+private:
+    void work()
+    {
+        while (true) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] {
+                    return m_stop || m_next == m_files.size() || m_next < m_n_taken + m_in_flight;
+                });
+                if (m_stop || m_next == m_files.size())
+                    return;
+                i = m_next++;
+            }
+
+            auto out = std::make_unique<loaded_module>();
+            out->ctx.setDiagnosticHandlerCallBack(diagnose, &out->diag);
+            const auto start = std::chrono::steady_clock::now();
+            out->module = load_reachable(m_files[i], out->ctx, out->diag, m_roots, out->n_skipped, out->n_dropped);
+            if (out->module && (out->diag.has_error || broken(*out->module, m_files[i], out->diag)))
+                out->module.reset();
+            out->ms = ms_since(start);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_slots[i] = std::move(out);
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    const std::vector<std::string>& m_files;
+    const std::set<std::string>& m_roots;
+    std::vector<std::unique_ptr<loaded_module>> m_slots;
+    const size_t m_in_flight;
+    size_t m_next = 0;
+    size_t m_n_taken = 0;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<std::thread> m_threads;
+}; // class prefetcher
+
+// Calls `fn` on every input that loads, in order, each in its own context; it is freed right after.
+void for_each_module(const std::vector<std::string>& files, const std::set<std::string>& roots, run_stats& stats,
+    const std::function<void(size_t, Module&)>& fn, bool print_errors = true)
+{
+    const unsigned n_threads = s_jobs ? s_jobs.getValue() : std::max(1u, std::thread::hardware_concurrency());
+    prefetcher loader(files, roots, n_threads, s_in_flight ? s_in_flight.getValue() : 2 * n_threads);
+    for (size_t i = 0; i < files.size(); ++i) {
+        auto loaded = loader.take(i);
+        if (print_errors)
+            errs() << loaded->diag.log;
+        stats.load += loaded->ms;
+        stats.n_skipped += loaded->n_skipped;
+        stats.n_dropped += loaded->n_dropped;
+        if (!loaded->module) {
+            ++stats.n_failed;
+            continue;
+        }
+        fn(i, *loaded->module);
+    }
+}
+
+bool write(const Module& M)
+{
+    std::error_code ec;
+    ToolOutputFile out(s_output, ec, s_text ? sys::fs::OF_TextWithCRLF : sys::fs::OF_None);
+    if (ec) {
+        errs() << "cannot write " << s_output << ": " << ec.message() << '\n';
+        return false;
+    }
+    if (s_text)
+        M.print(out.os(), nullptr);
+    else
+        WriteBitcodeToFile(M, out.os());
+    out.keep();
+    return true;
+}
+
+void analyze_separately(
+    const std::vector<std::string>& files, const std::set<std::string>& roots, pipeline& mkint, run_stats& stats)
+{
+    for_each_module(files, roots, stats, [&](size_t i, Module& M) {
+        const auto start = std::chrono::steady_clock::now();
+        mkint.run(M);
+        const double ms = ms_since(start);
+        stats.analysis += ms;
+        stats.slowest.emplace_back(ms, files[i]);
+
+        const size_t n = print_findings(M, files[i]);
+        stats.n_findings += n;
+        errs() << format("[%zu/%zu] ", i + 1, files.size()) << files[i] << ": " << n << " findings, "
+               << format("%.1f ms\n", ms);
+    });
+}
+
+// Functions called (or reached from a source) in any module, as of the merged summary: roots of the lazy
+// materialization besides the sources, as their bodies decide the taint and sinks seen by the other modules.
+std::set<std::string> summarized_functions(const std::string& merged_path)
+{
+    std::set<std::string> out;
+    mkint::module_summary merged;
+    std::string error;
+    if (merged_path.empty() || !mkint::read_summary(merged_path, merged, error))
+        return out;
+    for (const auto& [name, f] : merged.funcs)
+        out.insert(name);
+    return out;
+}
+
+// Summary rounds: every module is analyzed (without solving) against the summary merged in the previous round, until
+// the merged summary does not change.
+bool summarize(const std::vector<std::string>& files, const std::string& dir, pipeline& mkint, run_stats& stats)
+{
+    auto& opts = mkint::summary_options();
+    const std::string merged_path = dir + "/merged.json";
+    std::string last;
+    for (unsigned round = 0; round < std::max(1u, s_rounds.getValue()); ++round) {
+        std::vector<mkint::module_summary> summaries;
+        run_stats round_stats; // inputs that do not load are only counted once, by the final analysis.
+        const auto roots = summarized_functions(round ? merged_path : "");
+        for_each_module(files, roots, round_stats, [&](size_t i, Module& M) {
+            opts = { round ? merged_path : "", dir + "/" + std::to_string(i) + ".json", true };
+            const auto start = std::chrono::steady_clock::now();
+            mkint.run(M);
+            stats.summary += ms_since(start);
+
+            mkint::module_summary summary;
+            std::string error;
+            if (!mkint::read_summary(opts.out, summary, error)) {
+                errs() << "cannot read the summary of " << files[i] << ": " << error << '\n';
+                return;
+            }
+            summaries.push_back(std::move(summary));
+        }, round == 0);
+        stats.load += round_stats.load;
+
+        std::string error;
+        if (!mkint::write_summary(mkint::merge_summaries(summaries), merged_path, error)) {
+            errs() << "cannot write " << merged_path << ": " << error << '\n';
+            return false;
+        }
+
+        auto buf = MemoryBuffer::getFile(merged_path);
+        const std::string merged = buf ? (*buf)->getBuffer().str() : "";
+        errs() << "summary round " << round + 1 << ": " << summaries.size() << " modules, " << merged.size()
+               << " bytes merged\n";
+        if (merged == last)
+            return true;
+        last = merged;
+    }
+    if (s_rounds > 1)
+        errs() << "warning: the summary did not converge within " << s_rounds << " rounds; the analysis may miss "
+               << "ranges and taint crossing more modules (raise -rounds)\n";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    InitLLVM init(argc, argv);
+    cl::ParseCommandLineOptions(argc, argv, "MiniKint whole-program driver\n");
+    mkint::log_warnings_only(); // stdout is for the findings.
+
+    std::vector<std::string> files;
+    for (const auto& input : s_inputs)
+        collect(input, files);
+
+    if ((s_separate || s_thin) && !s_output.empty()) {
+        errs() << "-o is only supported for linked inputs\n";
+        return 1;
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    run_stats stats;
+    pipeline mkint;
+
+    if (s_thin) {
+        std::string dir = s_summary_dir;
+        if (dir.empty()) {
+            SmallString<128> tmp;
+            if (auto ec = sys::fs::createUniqueDirectory("mkint-summaries", tmp)) {
+                errs() << "cannot create a summary directory: " << ec.message() << '\n';
+                return 1;
+            }
+            dir = tmp.str().str();
+        } else if (auto ec = sys::fs::create_directories(dir)) {
+            errs() << "cannot create " << dir << ": " << ec.message() << '\n';
+            return 1;
+        }
+
+        if (!summarize(files, dir, mkint, stats))
+            return 1;
+        auto& opts = mkint::summary_options();
+        opts = { dir + "/merged.json", "", false };
+        analyze_separately(files, summarized_functions(opts.in), mkint, stats);
+        if (s_summary_dir.empty())
+            sys::fs::remove_directories(dir);
+    } else if (s_separate) {
+        analyze_separately(files, {}, mkint, stats);
+    } else {
+        LLVMContext ctx;
+        diag_state diag;
+        ctx.setDiagnosticHandlerCallBack(diagnose, &diag);
+
+        // inputs are loaded lazily: the linker only materializes the bodies it copies into the linked module.
+        auto linked = std::make_unique<Module>("mkint-linked", ctx);
+        Linker linker(*linked);
+        for (size_t i = 0; i < files.size(); ++i) {
+            const auto& path = files[i];
+            diag = {};
+
+            auto start = std::chrono::steady_clock::now();
+            auto M = load(path, ctx, true, diag);
+            stats.load += ms_since(start);
+            if (!M) {
+                errs() << diag.log;
+                ++stats.n_failed;
+                continue;
+            }
+
+            start = std::chrono::steady_clock::now();
+            if (linker.linkInModule(std::move(M)) || diag.has_error) {
+                diag.log += "cannot link " + path + "\n";
+                ++stats.n_failed;
+            }
+            stats.link += ms_since(start);
+            errs() << diag.log;
+        }
+
+        diag = {};
+        if (broken(*linked, "mkint-linked", diag)) {
+            errs() << diag.log;
+            return 1;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        mkint.run(*linked);
+        stats.analysis += ms_since(start);
+        stats.n_findings = print_findings(*linked, "mkint-linked");
+
+        if (!s_output.empty() && !write(*linked))
+            return 1;
+    }
+
+    errs() << files.size() - stats.n_failed << "/" << files.size() << " inputs analyzed, " << stats.n_findings
+           << " findings\n";
+    if (stats.n_skipped)
+        errs() << stats.n_skipped << " function bodies not reachable from taint sources were not materialized\n";
+    if (stats.n_dropped)
+        errs() << stats.n_dropped << " function bodies not reachable from taint sources were dropped after parsing "
+               << "(no summary index to find the callers of sources)\n";
+    errs() << format("load %.1f ms, link %.1f ms, summaries %.1f ms, analysis %.1f ms, total %.1f ms\n", stats.load,
+        stats.link, stats.summary, stats.analysis, ms_since(begin));
+    auto& slowest = stats.slowest;
+    if (!slowest.empty()) {
+        const size_t n = std::min<size_t>(5, slowest.size());
+        std::partial_sort(slowest.begin(), slowest.begin() + n, slowest.end(), std::greater<>());
+        errs() << "slowest modules:\n";
+        for (size_t i = 0; i < n; ++i)
+            errs() << format("  %10.1f ms  ", slowest[i].first) << slowest[i].second << '\n';
+    }
+
+    return stats.n_failed ? 1 : 0;
+}
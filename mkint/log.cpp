@@ -46,19 +46,20 @@ const nullstream& operator<<(nullstream&& os, const T& value)
 }
 
 static nullstream s_null_stream;
-static std::ostream& s_log_stream = []() -> std::ostream& {
+static std::ostream* s_log_stream = []() -> std::ostream* {
     if (std::getenv(LOG_ENV_VAR)) {
         assert(std::strlen(LOG_ENV_VAR) > 0);
         static std::ofstream log_file(std::getenv(LOG_ENV_VAR));
-        return log_file;
+        return &log_file;
     } else if (std::getenv("MKINT_STDERR")) {
-        return std::cerr;
+        return &std::cerr;
     } else if (std::getenv("MKINT_QUIET")) {
-        return s_null_stream;
+        return &s_null_stream;
     } else {
-        return std::cout;
+        return &std::cout;
     }
 }();
+static std::ostream* s_warn_stream = s_log_stream; // warnings and failed checks.
 
 mkint::detail::log_wrapper::log_wrapper(mkint::detail::log_wrapper&& wrapper)
     : m_stream(wrapper.m_stream)
@@ -103,26 +104,36 @@ mkint::detail::log_wrapper::~log_wrapper()
     }
 }
 
+bool mkint::log_enabled() { return s_log_stream != &s_null_stream; }
+
+void mkint::log_warnings_only()
+{
+    if (std::getenv(LOG_ENV_VAR) || std::getenv("MKINT_STDERR") || std::getenv("MKINT_QUIET"))
+        return;
+    s_log_stream = &s_null_stream;
+    s_warn_stream = &std::cerr;
+}
+
 mkint::detail::log_wrapper mkint::log()
 {
-    return mkint::detail::log_wrapper(s_log_stream, LOG_STYLE_FG, LOG_STYLE_BG, LOG_PROMPT, rang::style::reset, '\t');
+    return mkint::detail::log_wrapper(*s_log_stream, LOG_STYLE_FG, LOG_STYLE_BG, LOG_PROMPT, rang::style::reset, '\t');
 }
 
 mkint::detail::log_wrapper mkint::debug()
 {
-    return mkint::detail::log_wrapper(s_log_stream, DEBUG_STYLE_FG, DEBUG_STYLE_BG, DEBUG_PROMPT, rang::style::reset, '\t');
+    return mkint::detail::log_wrapper(*s_log_stream, DEBUG_STYLE_FG, DEBUG_STYLE_BG, DEBUG_PROMPT, rang::style::reset, '\t');
 }
 
 mkint::detail::log_wrapper mkint::warn()
 {
-    return mkint::detail::log_wrapper(s_log_stream, WARN_STYLE_FG, WARN_PROMPT, rang::style::reset, '\t');
+    return mkint::detail::log_wrapper(*s_warn_stream, WARN_STYLE_FG, WARN_PROMPT, rang::style::reset, '\t');
 }
 
 mkint::detail::log_wrapper mkint::check(bool cond, bool abort, std::string_view prompt, std::string_view file, size_t line)
 {
     if (!cond) {
         auto wrapper = mkint::detail::log_wrapper(
-            s_log_stream,
+            *s_warn_stream,
             CHECK_STYLE_FG, CHECK_STYLE_BG, CHECK_PROMPT, rang::style::reset, ' ',
             rang::fg::yellow, prompt, " at ", file, ':', line, '\t', rang::style::reset);
 
@@ -69,6 +69,13 @@ namespace detail {
     }; // class log_wrapper
 }
 
+// false if the log goes nowhere (MKINT_QUIET).
+bool log_enabled();
+
+// Unless the environment picks a destination, drop the log and send warnings and failed checks to stderr: for tools
+// whose own output goes to stdout.
+void log_warnings_only();
+
 detail::log_wrapper log();
 detail::log_wrapper debug();
 detail::log_wrapper warn();
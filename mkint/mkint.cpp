@@ -1,14 +1,20 @@
 #include "log.hpp"
 #include "rang.hpp"
+#include "smt.hpp"
+#include "summary.hpp"
 
 #include <cxxabi.h>
 
 #include <llvm/ADT/APInt.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/Hashing.h>
 #include <llvm/ADT/MapVector.h>
 #include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringRef.h>
+#include <llvm/Analysis/ValueTracking.h>
 #include <llvm/IR/Argument.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/ConstantRange.h>
@@ -27,6 +33,7 @@
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Passes/PassPlugin.h>
 #include <llvm/Support/Casting.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Transforms/Scalar/SROA.h>
 #include <llvm/Transforms/Utils/Mem2Reg.h>
@@ -37,13 +44,18 @@
 #include <array>
 #include <cassert>
 #include <cctype>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <limits>
 #include <map>
+#include <numeric>
 #include <optional>
+#include <set>
 #include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -54,8 +66,74 @@ using namespace llvm;
 constexpr const char* MKINT_IR_TAINT = "mkint.taint";
 constexpr const char* MKINT_IR_SINK = "mkint.sink";
 constexpr const char* MKINT_IR_ERR = "mkint.err";
+constexpr const char* MKINT_IR_UNKNOWN = "mkint.unknown";
+constexpr const char* MKINT_IR_CEX = "mkint.cex";
 constexpr const char* MKINT_TAINT_SRC_SUFFX = ".mkint.arg";
 
+static cl::opt<unsigned> s_smt_timeout("mkint-smt-timeout",
+    cl::desc("Timeout (ms) of a single SMT query; 0 means no limit"), cl::init(0));
+static cl::opt<unsigned> s_smt_func_timeout("mkint-smt-func-timeout",
+    cl::desc("Total SMT solving budget (ms) per function; 0 means no limit"), cl::init(0));
+static cl::opt<unsigned> s_smt_rlimit("mkint-smt-rlimit",
+    cl::desc("Z3 resource limit of a single SMT query; 0 means no limit"), cl::init(0));
+static cl::opt<mkint::smt_backend_kind> s_smt_backend("mkint-smt-backend", cl::desc("Constraint solving backend"),
+    cl::values(clEnumValN(mkint::smt_backend_kind::Z3, "z3", "Z3"),
+        clEnumValN(mkint::smt_backend_kind::INTERVAL, "interval", "in-tree interval reasoning only"),
+        clEnumValN(mkint::smt_backend_kind::HYBRID, "hybrid", "interval reasoning first, then Z3")),
+    cl::init(mkint::smt_backend_kind::Z3));
+static cl::opt<unsigned> s_smt_budget("mkint-smt-budget",
+    cl::desc("Total SMT solving budget (ms) of a module; 0 means no limit"), cl::init(0));
+static cl::opt<bool> s_smt_rank("mkint-smt-rank",
+    cl::desc("Solve the checks of a module in order of a risk score, across its functions"), cl::init(true));
+static cl::opt<bool> s_sink_only("mkint-sink-only",
+    cl::desc("Only check arithmetic in the backward slice of a sink (through operands, memory and branches)"),
+    cl::init(false));
+static cl::opt<unsigned> s_smt_threads("mkint-smt-threads",
+    cl::desc("Solve the checks and batched branch queries of a function in this many threads, each with its own Z3 "
+             "context (paths are still explored on one thread)"),
+    cl::init(1));
+static cl::opt<unsigned> s_branch_batch("mkint-branch-batch",
+    cl::desc("Suspend up to this many paths at branch feasibility queries and decide them in one batch"),
+    cl::init(32));
+static cl::opt<bool> s_callgraph_slice("mkint-callgraph-slice",
+    cl::desc("Only range-analyze functions connected to taint sources or sink callers through the call graph"),
+    cl::init(true));
+static cl::opt<bool> s_smt_batch("mkint-smt-batch",
+    cl::desc("Solve all integer checks of a basic block in one batched query"), cl::init(true));
+static cl::opt<bool> s_smt_slice("mkint-smt-slice",
+    cl::desc("Only assume the path constraints in the dependency cone of a query"), cl::init(true));
+static cl::opt<bool> s_path_memo("mkint-path-memo",
+    cl::desc("Skip a block reached with a path state subsumed by an explored one"), cl::init(true));
+static cl::opt<std::string> s_smt_dump("mkint-smt-dump",
+    cl::desc("Write every SMT query to this directory as an SMT-LIB2 file"), cl::value_desc("dir"), cl::init(""));
+static cl::opt<unsigned> s_smt_workers("mkint-smt-workers",
+    cl::desc("Solve Z3 queries in this many isolated worker processes; 0 solves them in-process"), cl::init(0));
+static cl::list<std::string> s_smt_portfolio("mkint-smt-portfolio",
+    cl::desc("Race these strategies (`default` or tactics joined by `+`) in threads on hard Z3 queries"),
+    cl::CommaSeparated);
+static cl::opt<unsigned> s_smt_portfolio_after("mkint-smt-portfolio-after",
+    cl::desc("Time (ms) a query gets in-process before the portfolio races on it"), cl::init(100));
+static cl::opt<unsigned> s_smt_worker_mem("mkint-smt-worker-mem",
+    cl::desc("Memory (MiB) an SMT worker process may allocate beyond what it inherits; 0 means no limit"),
+    cl::init(0));
+static cl::opt<bool> s_smt_narrow("mkint-smt-narrow",
+    cl::desc("Encode values whose range fits in fewer bits as extensions of narrower constants"), cl::init(true));
+static cl::opt<unsigned> s_smt_inline("mkint-smt-inline",
+    cl::desc("Inline pure single-block callees with at most this many instructions into the SMT encoding"),
+    cl::init(0));
+static cl::opt<std::string, true> s_summary_in("mkint-summary-in",
+    cl::desc("Use the merged whole-program summary in this file for functions and globals of other modules"),
+    cl::value_desc("file"), cl::location(mkint::summary_options().in));
+static cl::opt<std::string, true> s_summary_out("mkint-summary-out",
+    cl::desc("Write a summary of the module (ranges, taint, sinks and calls) to this file"), cl::value_desc("file"),
+    cl::location(mkint::summary_options().out));
+static cl::opt<bool, true> s_summary_only("mkint-summary-only",
+    cl::desc("Stop after writing the summary: no solving and no reports"), cl::location(mkint::summary_options().only));
+static cl::opt<bool> s_cex_md("mkint-cex-md",
+    cl::desc("Attach a counter example to every bug as !mkint.cex metadata"), cl::init(false));
+static cl::opt<bool> s_unknown_as_bug("mkint-unknown-as-bug",
+    cl::desc("Report checks whose SMT verdict is unknown as bugs"), cl::init(false));
+
 static std::string demangle(const char* name)
 {
     int status = -1;
@@ -187,6 +265,17 @@ template <interr err_t, typename I> static std::enable_if_t<!std::is_pointer_v<I
     mark_err<err_t>(&inst);
 }
 
+static void mark_unknown(Instruction* inst, interr err)
+{
+    auto& ctx = inst->getContext();
+    std::string prefix = "";
+    if (MDNode* omd = inst->getMetadata(MKINT_IR_UNKNOWN)) {
+        prefix = cast<MDString>(omd->getOperand(0))->getString().str() + " + ";
+    }
+    auto md = MDNode::get(ctx, MDString::get(ctx, prefix + std::string(mkstr(err))));
+    inst->setMetadata(MKINT_IR_UNKNOWN, md);
+}
+
 static void mark_taint(Instruction& inst, std::string_view taint_name = "")
 {
     auto& ctx = inst.getContext();
@@ -206,7 +295,8 @@ static std::vector<CallInst*> get_taint_source(Function& F)
     std::vector<CallInst*> ret;
     // judge if this function is the taint source.
     const auto name = F.getName();
-    if (is_taint_src(name)) {
+    // a source declared here is defined (and its arguments marked) in another module.
+    if (is_taint_src(name) && !F.isDeclaration()) {
         // mark all this function as a taint source.
         // Unfortunately arguments cannot be marked with metadata...
         // We need to rewrite the arguments -> unary callers and mark the callers.
@@ -264,10 +354,74 @@ crange compute_binary_rng(const BinaryOperator* op, crange lhs, crange rhs)
     return rhs;
 }
 
+struct bin_check {
+    BinaryOperator* op;
+    interr et;
+    bool is_signed;
+    z3::expr lhs, rhs; // operands on the checked path.
+    z3::expr query; // sat means bug.
+};
+
+struct cex_t {
+    APInt lhs, rhs;
+    bool is_signed;
+};
+
+using symset_t = SmallVector<unsigned, 4>;
+
+struct path_cons {
+    z3::expr lit;
+    const symset_t* syms;
+    unsigned id; // of the constraint: ASTs are hash-consed, so equal constraints share it.
+};
+
+// What a path has established for the subtree of a block: the terms bound to the values it uses, and the constraints
+// over their symbols.
+struct path_state {
+    std::vector<std::pair<const Value*, unsigned>> bindings; // sorted.
+    std::vector<unsigned> cons; // sorted.
+};
+
+// What one block (and the edge into it) added to a path: replayed to resume a path suspended elsewhere.
+struct path_frame {
+    std::shared_ptr<const path_frame> parent;
+    std::vector<path_cons> cons; // the ones of the edge first.
+    std::vector<std::pair<const Value*, z3::expr>> bindings;
+};
+
+struct pending_checks {
+    std::vector<bin_check> checks;
+    // the path the checks were collected on: the ancestors of the frame of their block, and the first `n_cons`
+    // constraints of that frame (the ones of the edge into the block).
+    std::shared_ptr<const path_frame> frame;
+    size_t n_cons;
+    const Function* func;
+    unsigned score;
+};
+
+// A path about to enter `cur` from `pred`. It is suspended while the feasibility of its edge is being decided.
+struct path_task {
+    BasicBlock* cur;
+    BasicBlock* pred;
+    std::shared_ptr<const path_frame> frame; // the path up to `pred`.
+    bool feasible = false; // the edge is known to be feasible, and `edge` holds what it adds.
+    path_frame edge;
+    std::vector<path_cons> cone; // of the edge constraint, while the query is pending.
+};
+
 struct MKintPass : public PassInfoMixin<MKintPass> {
     MKintPass()
-        : m_solver(std::nullopt)
+        : m_solver(mkint::make_smt_backend({ s_smt_backend, s_smt_rlimit, s_smt_dump, s_smt_workers, s_smt_worker_mem,
+            { s_smt_portfolio.begin(), s_smt_portfolio.end() }, s_smt_portfolio_after }))
     {
+        // the threads run plain Z3: other backends would be bypassed.
+        m_parallel = s_smt_threads > 1;
+        if (m_parallel
+            && (s_smt_backend != mkint::smt_backend_kind::Z3 || s_smt_workers || !s_smt_portfolio.empty()
+                || !s_smt_dump.empty())) {
+            MKINT_WARN() << "-mkint-smt-threads only works with the plain Z3 backend; solving in one thread";
+            m_parallel = false;
+        }
     }
 
     void backedge_analysis(const Function& F)
@@ -433,8 +587,8 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
             } else if (const PHINode* op = dyn_cast<PHINode>(&inst)) {
                 for (size_t i = 0; i < op->getNumIncomingValues(); ++i) {
                     auto pred = op->getIncomingBlock(i);
-                    if (m_backedges[bb].contains(pred)) {
-                        continue; // skip backedge
+                    if (m_backedges[bb].contains(pred) || !is_executable(pred, bb)) {
+                        continue; // skip backedge and not executable incoming edges
                     }
                     new_range = new_range.unionWith(get_range_by_bb(op->getIncomingValue(i), pred));
                 }
@@ -488,11 +642,54 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                 sum_rng[bb] = sum_rng.count(bb) ? sum_rng[bb].unionWith(rng) : rng;
     }
 
+    // Blocks not (yet) known to be executable, i.e. reachable from the entry through edges whose condition the
+    // ranges can satisfy, are neither merged into their successors nor solved.
+    bool is_executable(const BasicBlock* bb) const
+    {
+        auto it = m_func2exec_bbs.find(bb->getParent());
+        return it == m_func2exec_bbs.end() || it->second.contains(bb);
+    }
+
+    // Same for the edge `pred -> bb`: an executable block may still branch to a successor along an edge whose
+    // condition the ranges cannot satisfy.
+    bool is_executable(const BasicBlock* pred, const BasicBlock* bb) const
+    {
+        auto it = m_func2exec_edges.find(bb->getParent());
+        return it == m_func2exec_edges.end() || it->second.contains({ pred, bb });
+    }
+
+    // Conditional branches of executable blocks with an edge the converged range analysis never took (backedges are
+    // not merged, hence never taken).
+    void find_impossible_branches()
+    {
+        for (auto F : m_range_analysis_funcs) {
+            for (const auto& bb : *F) {
+                if (!is_executable(&bb))
+                    continue;
+                const auto br = dyn_cast<BranchInst>(bb.getTerminator());
+                if (!br || !br->isConditional())
+                    continue;
+                const auto cmp = dyn_cast<ICmpInst>(br->getCondition());
+                if (!cmp || !cmp->getOperand(0)->getType()->isIntegerTy())
+                    continue;
+
+                for (unsigned i = 0; i < br->getNumSuccessors(); ++i) {
+                    const auto succ = br->getSuccessor(i);
+                    if (!m_backedges[succ].contains(&bb) && !is_executable(&bb, succ))
+                        m_impossible_branches[cmp] = i == 0; // TODO: higher precision.
+                }
+            }
+        }
+    }
+
     void range_analysis(Function& F)
     {
         MKINT_LOG() << "Range Analysis -> " << F.getName();
 
         auto& bb_range = m_func2range_info[&F];
+        // grow monotonically over the iterations, like the ranges: an edge is taken once its condition may hold.
+        auto& exec_bbs = m_func2exec_bbs[&F];
+        auto& exec_edges = m_func2exec_edges[&F];
 
         for (auto& bbref : F) {
             auto bb = &bbref;
@@ -504,6 +701,8 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                 // avoid backedge: pred can't be a successor of bb.
                 if (m_backedges[bb].contains(pred))
                     continue; // skip backedge
+                if (!exec_bbs.contains(pred))
+                    continue; // its ranges are not reached yet.
 
                 MKINT_LOG() << "Merging: " << get_bb_label(pred) << "\t -> " << get_bb_label(bb);
                 auto branch_rng = bb_range[pred];
@@ -539,9 +738,8 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                                 }
 
                                 if (branch_rng[lhs].isEmptySet() || branch_rng[rhs].isEmptySet())
-                                    m_impossible_branches[cmp] = is_true_br; // TODO: higher precision.
-                                else
-                                    branch_rng[cmp] = crange(APInt(1, is_true_br));
+                                    continue; // the edge is not taken (yet).
+                                branch_rng[cmp] = crange(APInt(1, is_true_br));
                             }
                         }
                     }
@@ -575,16 +773,136 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                     MKINT_CHECK_ABORT(false) << "Unknown terminator: " << *pred->getTerminator();
                 }
 
+                exec_bbs.insert(bb);
+                exec_edges.insert({ pred, bb });
                 analyze_one_bb_range(bb, branch_rng);
             }
 
             if (bb->isEntryBlock()) {
                 MKINT_LOG() << "No predecessors: " << bb;
+                exec_bbs.insert(bb);
                 analyze_one_bb_range(bb, sum_rng);
             }
         }
     }
 
+    // The merged summary of a function visible to other modules, if any.
+    const mkint::function_summary* summary_of(const Function* F) const
+    {
+        if (F->hasLocalLinkage())
+            return nullptr;
+        auto it = m_summary.funcs.find(F->getName().str());
+        return it == m_summary.funcs.end() ? nullptr : &it->second;
+    }
+
+    // The summary of this module, written once range analysis converged.
+    mkint::module_summary summarize(Module& M)
+    {
+        mkint::module_summary out;
+        const auto is_tainted = [this](const Value* v) {
+            if (auto inst = dyn_cast<Instruction>(v))
+                return nullptr != inst->getMetadata(MKINT_IR_TAINT);
+            if (auto arg = dyn_cast<Argument>(v))
+                return m_taint_funcs.contains(const_cast<Function*>(arg->getParent()));
+            return false;
+        };
+
+        // sinks reachable within the module, closed over the calls to its own definitions.
+        DenseSet<const Function*> reaches_sink;
+        for (auto& F : M) {
+            if (m_taint_funcs.contains(&F)) {
+                reaches_sink.insert(&F);
+            } else {
+                for (auto& inst : instructions(F)) {
+                    if (inst.getMetadata(MKINT_IR_SINK)) {
+                        reaches_sink.insert(&F);
+                        break;
+                    }
+                }
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto& F : M) {
+                if (F.isDeclaration() || reaches_sink.contains(&F))
+                    continue;
+                for (auto& inst : instructions(F)) {
+                    auto call = dyn_cast<CallInst>(&inst);
+                    auto callee = call ? call->getCalledFunction() : nullptr;
+                    if (!callee)
+                        continue;
+                    if (auto fs = summary_of(callee); reaches_sink.contains(callee) || (fs && fs->reaches_sink)) {
+                        changed = reaches_sink.insert(&F).second;
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (auto& F : M) {
+            if (F.isDeclaration() || F.hasLocalLinkage())
+                continue;
+
+            auto& fs = out.funcs[F.getName().str()];
+            fs.defined = true;
+            fs.tainted = m_taint_funcs.contains(&F);
+            fs.reaches_sink = reaches_sink.contains(&F);
+            if (F.getReturnType()->isIntegerTy() && m_func2ret_range.count(&F))
+                fs.ret = m_func2ret_range[&F];
+            for (const auto& arg : F.args()) {
+                std::optional<ConstantRange> rng;
+                if (arg.getType()->isIntegerTy())
+                    rng = get_range_by_bb(&arg, &F.getEntryBlock());
+                fs.args.push_back(rng);
+            }
+
+            for (auto& inst : instructions(F)) {
+                auto call = dyn_cast<CallInst>(&inst);
+                auto callee = call ? call->getCalledFunction() : nullptr;
+                if (!callee || !callee->isDeclaration() || callee->isIntrinsic()
+                    || is_taint_src_arg_call(callee->getName()) || !is_executable(inst.getParent()))
+                    continue;
+                fs.callees.push_back(callee->getName().str());
+
+                // how this module calls the declaration.
+                auto& cs = out.funcs[callee->getName().str()];
+                cs.args.resize(callee->arg_size());
+                for (const auto& arg : callee->args()) {
+                    const auto op = call->getArgOperand(arg.getArgNo());
+                    cs.tainted |= is_tainted(op);
+                    if (!arg.getType()->isIntegerTy())
+                        continue;
+                    const ConstantRange rng = get_range_by_bb(op, inst.getParent());
+                    auto& sum = cs.args[arg.getArgNo()];
+                    sum = sum ? sum->unionWith(rng) : rng;
+                }
+            }
+        }
+
+        for (const auto& GV : M.globals()) {
+            if (GV.hasLocalLinkage() || !GV.getValueType()->isIntegerTy())
+                continue;
+            if (!GV.isDeclaration()) {
+                if (m_global2range.count(&GV))
+                    out.globals.insert({ GV.getName().str(), m_global2range[&GV] });
+                continue;
+            }
+
+            // the values stored to a global defined elsewhere.
+            std::optional<ConstantRange> stored;
+            for (const auto user : GV.users()) {
+                auto store = dyn_cast<StoreInst>(user);
+                if (!store || store->getPointerOperand() != &GV || !is_executable(store->getParent()))
+                    continue;
+                const ConstantRange rng = get_range_by_bb(store->getValueOperand(), store->getParent());
+                stored = stored ? stored->unionWith(rng) : rng;
+            }
+            if (stored)
+                out.globals.insert({ GV.getName().str(), *stored });
+        }
+        return out;
+    }
+
     static std::string get_bb_label(const BasicBlock* bb)
     {
         std::string str;
@@ -654,6 +972,8 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                     if (!f->isDeclaration() && taint_bcast_sink(f->args())) {
                         you_see_sink = true;
                         m_taint_funcs.insert(f);
+                    } else if (auto fs = summary_of(f); fs && f->isDeclaration() && fs->reaches_sink) {
+                        you_see_sink = true; // defined in another module.
                     }
                 }
             }
@@ -800,9 +1120,12 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
     {
         MKINT_LOG() << "Running MKint pass on module " << M.getName();
 
-        // FIXME: This is a hack.
-        auto ctx = new z3::context; // let it leak.
-        m_solver = z3::solver(*ctx);
+        const auto& summary_opts = mkint::summary_options();
+        if (!summary_opts.in.empty()) {
+            std::string error;
+            if (!mkint::read_summary(summary_opts.in, m_summary, error))
+                MKINT_WARN() << "Cannot read the summary " << summary_opts.in << ": " << error;
+        }
 
         // Mark taint sources.
         for (auto& F : M) {
@@ -818,6 +1141,14 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
             }
         }
 
+        // called with tainted arguments from other modules.
+        for (auto& F : M) {
+            if (auto fs = summary_of(&F); fs && fs->tainted && !F.isDeclaration() && !is_taint_src(F.getName())) {
+                if (taint_bcast_sink(F.args()))
+                    m_taint_funcs.insert(&F);
+            }
+        }
+
         size_t n_tfunc_before = 0;
         do {
             n_tfunc_before = m_taint_funcs.size();
@@ -846,13 +1177,24 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
             const auto old_glb_rng = m_global2range;
             const auto old_glb_arrrng = m_garr2ranges;
             const auto old_fn_ret_rng = m_func2ret_range;
+            size_t old_n_exec = 0;
+            for (const auto& [F, bbs] : m_func2exec_bbs)
+                old_n_exec += bbs.size();
+            for (const auto& [F, edges] : m_func2exec_edges)
+                old_n_exec += edges.size();
 
             for (auto F : m_range_analysis_funcs) {
                 range_analysis(*F);
             }
 
+            size_t n_exec = 0;
+            for (const auto& [F, bbs] : m_func2exec_bbs)
+                n_exec += bbs.size();
+            for (const auto& [F, edges] : m_func2exec_edges)
+                n_exec += edges.size();
+
             if (m_func2range_info == old_fn_rng && old_glb_rng == m_global2range && old_fn_ret_rng == m_func2ret_range
-                && old_glb_arrrng == m_garr2ranges)
+                && old_glb_arrrng == m_garr2ranges && old_n_exec == n_exec)
                 break;
             if (++try_count > max_try) {
                 MKINT_LOG() << "[Iterative Range Analysis] "
@@ -860,17 +1202,106 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                 break;
             }
         }
+        // only from the converged edges: an early round may not have reached the ranges that take an edge.
+        this->find_impossible_branches();
         this->pring_all_ranges();
 
+        if (!summary_opts.out.empty()) {
+            std::string error;
+            if (!mkint::write_summary(summarize(M), summary_opts.out, error))
+                MKINT_WARN() << "Cannot write the summary " << summary_opts.out << ": " << error;
+        }
+        if (summary_opts.only) {
+            this->clear_module_state();
+            return PreservedAnalyses::all();
+        }
+
         this->smt_solving(M);
 
+        if (const auto stats = m_solver->stats(); !stats.empty())
+            MKINT_LOG() << "[SMT Solving] " << m_solver->name() << " backend: " << stats;
+
+        this->report_bugs();
+        this->report_unknowns();
         this->mark_errors();
 
+        // the pass instance (and its Z3 context) is reused by the following modules.
+        this->clear_module_state();
+        m_solver->reset();
+
         return PreservedAnalyses::all();
     }
 
+    // Functions whose ranges can matter: taint sources, tainted functions and callers of sinks, with their callers
+    // (which decide their argument ranges) and callees (which decide return ranges), transitively.
+    DenseSet<const Function*> callgraph_slice(Module& M)
+    {
+        DenseMap<const Function*, SmallVector<const Function*, 4>> callers, callees;
+        std::vector<const Function*> seeds;
+        for (auto& F : M) {
+            bool is_seed = is_taint_src(F.getName()) || m_taint_funcs.contains(&F);
+            for (auto& inst : instructions(F)) {
+                is_seed |= nullptr != inst.getMetadata(MKINT_IR_SINK);
+                if (auto call = dyn_cast<CallInst>(&inst)) {
+                    if (auto callee = call->getCalledFunction()) {
+                        callees[&F].push_back(callee);
+                        callers[callee].push_back(&F);
+                    } else {
+                        is_seed = true; // indirect calls may reach anything: keep the caller and what it calls.
+                    }
+                }
+            }
+            if (is_seed)
+                seeds.push_back(&F);
+        }
+
+        DenseSet<const Function*> slice;
+        for (const auto* edges : { &callers, &callees }) {
+            DenseSet<const Function*> visited(seeds.begin(), seeds.end());
+            std::vector<const Function*> worklist = seeds;
+            while (!worklist.empty()) {
+                auto F = worklist.back();
+                worklist.pop_back();
+                slice.insert(F);
+                if (auto it = edges->find(F); it != edges->end()) {
+                    for (auto next : it->second) {
+                        if (visited.insert(next).second)
+                            worklist.push_back(next);
+                    }
+                }
+            }
+        }
+        return slice;
+    }
+
+    // A function outside of the slice is not analyzed, so whatever it stores to a global may be anything.
+    void havoc_stores(Function& F)
+    {
+        for (auto& inst : instructions(F)) {
+            auto store = dyn_cast<StoreInst>(&inst);
+            if (!store || !store->getValueOperand()->getType()->isIntegerTy())
+                continue;
+
+            const auto ptr = store->getPointerOperand();
+            if (const auto gv = dyn_cast<GlobalVariable>(ptr); gv && m_global2range.count(gv)) {
+                m_global2range[gv] = crange(m_global2range[gv].getBitWidth(), true);
+            } else if (const auto gep = dyn_cast<GetElementPtrInst>(ptr)) {
+                auto garr = dyn_cast<GlobalVariable>(gep->getPointerOperand());
+                if (garr && m_garr2ranges.count(garr)) {
+                    for (auto& rng : m_garr2ranges[garr])
+                        rng = crange(rng.getBitWidth(), true);
+                }
+            }
+        }
+    }
+
     void init_ranges(Module& M)
     {
+        DenseSet<const Function*> slice;
+        std::vector<Function*> sliced_out;
+        if (s_callgraph_slice)
+            slice = callgraph_slice(M);
+
         for (auto& F : M) {
             // Functions for range analysis:
             // 1. taint source -> taint sink.
@@ -885,11 +1316,23 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                             m_func2ret_range[&F] = crange(F.getReturnType()->getIntegerBitWidth(), false);
                         MKINT_LOG() << "Skip range analysis for func w/o impl [Empty Set]: " << F.getName()
                                     << "\tin taint_funcs? ";
+                    } else if (auto fs = summary_of(&F); fs && fs->ret && F.getReturnType()->isIntegerTy()
+                               && fs->ret->getBitWidth() == F.getReturnType()->getIntegerBitWidth()) {
+                        m_func2ret_range[&F] = *fs->ret;
+                        MKINT_LOG() << "Range of func w/o impl from the summary: " << F.getName() << " -> "
+                                    << m_func2ret_range[&F];
                     } else {
                         if (F.getReturnType()->isIntegerTy())
                             m_func2ret_range[&F] = crange(F.getReturnType()->getIntegerBitWidth(), true); // full.
                         MKINT_LOG() << "Skip range analysis for func w/o impl [Full Set]: " << F.getName();
                     }
+                } else if (s_callgraph_slice && !slice.contains(&F)) {
+                    // like a function without implementation.
+                    if (F.getReturnType()->isIntegerTy())
+                        m_func2ret_range[&F] = crange(F.getReturnType()->getIntegerBitWidth(), true); // full.
+                    sliced_out.push_back(&F);
+                    MKINT_LOG() << "Skip range analysis for func out of the call graph slice [Full Set]: "
+                                << F.getName();
                 } else {
                     if (F.getReturnType()->isIntegerTy())
                         m_func2ret_range[&F] = crange(F.getReturnType()->getIntegerBitWidth(), false); // empty.
@@ -905,6 +1348,12 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                                 init_blk[&arg] = crange(arg.getType()->getIntegerBitWidth(), true);
                             } else {
                                 init_blk[&arg] = crange(arg.getType()->getIntegerBitWidth(), false);
+                                // the calls from other modules.
+                                if (auto fs = summary_of(&F); fs && arg.getArgNo() < fs->args.size()) {
+                                    const auto& rng = fs->args[arg.getArgNo()];
+                                    if (rng && rng->getBitWidth() == arg.getType()->getIntegerBitWidth())
+                                        init_blk[&arg] = *rng;
+                                }
                             }
                         }
                     }
@@ -959,6 +1408,13 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                 } else {
                     m_global2range[&GV] = crange(GV.getType()->getIntegerBitWidth()); // can be all range.
                 }
+
+                // the stores of other modules, or the range where it is defined.
+                if (auto it = m_summary.globals.find(GV.getName().str());
+                    !GV.hasLocalLinkage() && it != m_summary.globals.end()
+                    && it->second.getBitWidth() == GV.getValueType()->getIntegerBitWidth()) {
+                    m_global2range[&GV] = GV.hasInitializer() ? m_global2range[&GV].unionWith(it->second) : it->second;
+                }
             } else if (GV.getValueType()->isArrayTy()) { // int array.
                 const auto garr = dyn_cast<ArrayType>(GV.getValueType());
                 if (garr->getElementType()->isIntegerTy()) {
@@ -989,6 +1445,11 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                 MKINT_WARN() << "Unhandled global var type: " << *GV.getType() << " -> " << GV.getName();
             }
         }
+
+        for (auto F : sliced_out)
+            havoc_stores(*F);
+        if (s_callgraph_slice)
+            MKINT_LOG() << "[Range Analysis] " << sliced_out.size() << " functions out of the call graph slice";
     }
 
     void pring_all_ranges() const
@@ -1047,7 +1508,8 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
         }
     }
 
-    bool add_range_cons(const crange rng, const z3::expr& bv)
+    // false if `rng` is empty (unreachable); otherwise the range constraint of `bv` (if any) is appended to `cons`.
+    bool get_range_cons(const crange rng, const z3::expr& bv, std::vector<z3::expr>& cons)
     {
         if (rng.isFullSet() || bv.is_const())
             return true;
@@ -1057,17 +1519,153 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
             return false;
         }
 
-        m_solver.value().add(
-            z3::ule(bv, m_solver.value().ctx().bv_val(rng.getUnsignedMax().getZExtValue(), rng.getBitWidth())));
-        m_solver.value().add(
-            z3::uge(bv, m_solver.value().ctx().bv_val(rng.getUnsignedMin().getZExtValue(), rng.getBitWidth())));
+        cons.push_back(z3::ule(bv, m_solver->bv_val(rng.getUnsignedMax().getZExtValue(), rng.getBitWidth())));
+        cons.push_back(z3::uge(bv, m_solver->bv_val(rng.getUnsignedMin().getZExtValue(), rng.getBitWidth())));
         return true;
     }
 
+    bool add_range_cons(const crange rng, const z3::expr& bv)
+    {
+        std::vector<z3::expr> cons;
+        if (!get_range_cons(rng, bv, cons))
+            return false;
+
+        for (const auto& c : cons)
+            smt_add(c);
+        return true;
+    }
+
+    std::set<Instruction*>& err_insts(interr et)
+    {
+        switch (et) {
+        case interr::BAD_SHIFT:
+            return m_bad_shift_insts;
+        case interr::DIV_BY_ZERO:
+            return m_div_zero_insts;
+        default:
+            return m_overflow_insts;
+        }
+    }
+
+    // Counter examples are only extracted if someone consumes them (the log or `-mkint-cex-md`); they are rendered
+    // when reporting.
+    static bool want_cex() { return mkint::log_enabled() || s_cex_md; }
+
+    void report_check(const bin_check& c, z3::check_result res, const z3::model* model = nullptr)
+    {
+        const auto op = c.op;
+        if (res == z3::unknown) { // timeout, resource limit or budget exhausted.
+            if (mkint::log_enabled())
+                MKINT_WARN() << rang::fg::yellow << "[SMT Solving] unknown verdict of " << mkstr(c.et)
+                             << rang::style::reset << " at " << op->getParent()->getParent()->getName() << "::" << *op;
+            m_unknown_checks.emplace(op, c.et);
+        } else if (res == z3::sat) { // counter example
+            err_insts(c.et).insert(op);
+            if (!want_cex() || m_cex.count({ op, c.et }))
+                return;
+
+            const z3::model m = model ? *model : m_solver->get_model();
+            m_cex.try_emplace({ op, c.et },
+                cex_t { mkint::numeral_of(m.eval(c.lhs, true)), mkint::numeral_of(m.eval(c.rhs, true)), c.is_signed });
+        }
+    }
+
+    void report_bugs()
+    {
+        for (auto et : { interr::OVERFLOW, interr::DIV_BY_ZERO, interr::BAD_SHIFT }) {
+            for (auto inst : err_insts(et)) {
+                if (mkint::log_enabled())
+                    MKINT_WARN() << rang::fg::yellow << rang::style::bold << mkstr(et) << rang::style::reset << " at "
+                                 << rang::bg::black << rang::fg::red << inst->getFunction()->getName() << "::" << *inst
+                                 << rang::style::reset;
+
+                auto it = m_cex.find({ inst, et });
+                if (it == m_cex.end())
+                    continue;
+
+                const auto& [lhs, rhs, is_signed] = it->second;
+                const auto dec = [is_signed = is_signed](const APInt& v) { return toString(v, 10, is_signed); };
+                const auto hex = [](const APInt& v) {
+                    const auto digits = toString(v, 16, false);
+                    return "#x" + std::string((v.getBitWidth() + 3) / 4 - digits.size(), '0') + digits;
+                };
+                if (mkint::log_enabled())
+                    MKINT_WARN() << "Counter example: " << rang::bg::black << rang::fg::red << inst->getOpcodeName()
+                                 << '(' << hex(lhs) << ", " << hex(rhs) << ") -> " << inst->getOpcodeName() << '('
+                                 << dec(lhs) << ", " << dec(rhs) << ')' << rang::style::reset;
+
+                if (s_cex_md) {
+                    auto& ctx = inst->getContext();
+                    const auto str = std::string(inst->getOpcodeName()) + '(' + dec(lhs) + ", " + dec(rhs) + ')';
+                    inst->setMetadata(MKINT_IR_CEX, MDNode::get(ctx, MDString::get(ctx, str)));
+                }
+            }
+        }
+    }
+
+    // Solve the checks of one block. In batch mode, all checks are guarded by their own literals and we keep asking
+    // for a model satisfying any of the unresolved ones; every model may resolve several checks at once.
+    void solve_checks(std::vector<bin_check>& checks)
+    {
+        if (!s_smt_batch || checks.size() == 1) {
+            for (const auto& c : checks) {
+                m_solver->set_tag({ c.op, mkstr(c.et) });
+                report_check(c, smt_check(c.query));
+            }
+            checks.clear();
+            return;
+        }
+
+        std::vector<z3::expr> lits, queries;
+        for (const auto& c : checks) {
+            lits.push_back(fresh_lit());
+            queries.push_back(c.query);
+            m_solver->add(z3::implies(lits.back(), c.query));
+        }
+
+        std::vector<size_t> pending(checks.size());
+        std::iota(pending.begin(), pending.end(), 0);
+        while (!pending.empty()) {
+            z3::expr_vector any(m_solver->ctx());
+            for (auto i : pending)
+                any.push_back(lits[i]);
+
+            m_solver->set_tag({ checks[pending.front()].op, "batch" });
+            const auto res = smt_check(z3::mk_or(any), queries);
+            if (res == z3::unsat) // all remaining checks are safe.
+                break;
+
+            std::vector<size_t> left;
+            if (res == z3::sat) {
+                const z3::model m = m_solver->get_model();
+                for (auto i : pending) {
+                    if (m.eval(checks[i].query, true).is_true())
+                        report_check(checks[i], z3::sat, &m);
+                    else
+                        left.push_back(i);
+                }
+            }
+
+            if (res == z3::unknown || left.size() == pending.size()) {
+                // the joint query is too hard; fall back to one query per check.
+                for (auto i : pending) {
+                    m_solver->set_tag({ checks[i].op, mkstr(checks[i].et) });
+                    report_check(checks[i], smt_check(lits[i], { checks[i].query }));
+                }
+                break;
+            }
+            pending = std::move(left);
+        }
+        for (const auto& lit : lits)
+            retire(lit);
+        checks.clear();
+    }
+
     // for general: check overflow;
     // for shl:     check shift amount;
     // for div:     check divisor != 0;
-    void binary_check(BinaryOperator* op)
+    // `block_cons` are the range constraints preceding `op` in its block, which are not asserted yet.
+    void binary_check(BinaryOperator* op, const std::vector<z3::expr>& block_cons, std::vector<bin_check>& checks)
     {
         const auto& lhs_bv = v2sym(op->getOperand(0));
         const auto& rhs_bv = v2sym(op->getOperand(1));
@@ -1080,93 +1678,56 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
             return std::make_pair(false, false);
         }();
 
-        const auto check = [&, this](interr et, bool is_signed) {
-            if (m_solver.value().check() == z3::sat) { // counter example
-                z3::model m = m_solver.value().get_model();
-                MKINT_WARN() << rang::fg::yellow << rang::style::bold << mkstr(et) << rang::style::reset << " at "
-                             << rang::bg::black << rang::fg::red << op->getParent()->getParent()->getName()
-                             << "::" << *op << rang::style::reset;
-                auto lhs_bin = m.eval(lhs_bv, true);
-                auto rhs_bin = m.eval(rhs_bv, true);
-                if (is_signed) {
-                    MKINT_WARN() << "Counter example: " << rang::bg::black << rang::fg::red << op->getOpcodeName()
-                                 << '(' << lhs_bin << ", " << rhs_bin << ") -> " << op->getOpcodeName() << '('
-                                 << lhs_bin.as_int64() << ", " << rhs_bin.as_int64() << ')' << rang::style::reset;
-                } else {
-                    MKINT_WARN() << "Counter example: " << rang::bg::black << rang::fg::red << op->getOpcodeName()
-                                 << '(' << lhs_bin << ", " << rhs_bin << ") -> " << op->getOpcodeName() << '('
-                                 << lhs_bin.as_uint64() << ", " << rhs_bin.as_uint64() << ')' << rang::style::reset;
-                }
-
-                switch (et) {
-                case interr::OVERFLOW:
-                    m_overflow_insts.insert(op);
-                    break;
-                case interr::BAD_SHIFT:
-                    m_bad_shift_insts.insert(op);
-                    break;
-                case interr::DIV_BY_ZERO:
-                    m_div_zero_insts.insert(op);
-                    break;
-                default:
-                    break;
-                }
-            }
+        const auto check = [&, this](interr et, bool is_signed, const z3::expr& violation) {
+            z3::expr_vector query(m_solver->ctx());
+            query.push_back(violation);
+            for (const auto& c : block_cons)
+                query.push_back(c);
+            checks.push_back({ op, et, is_signed, lhs_bv, rhs_bv, z3::mk_and(query) });
         };
 
-        m_solver.value().push();
         switch (op->getOpcode()) {
         case Instruction::Add:
             if (!is_nsw) { // unsigned
-                m_solver.value().add(!z3 ::bvadd_no_overflow(lhs_bv, rhs_bv, false));
-                check(interr::OVERFLOW, false);
+                check(interr::OVERFLOW, false, !z3 ::bvadd_no_overflow(lhs_bv, rhs_bv, false));
             } else {
-                m_solver.value().add(!z3::bvadd_no_overflow(lhs_bv, rhs_bv, true));
-                m_solver.value().add(!z3::bvadd_no_underflow(lhs_bv, rhs_bv));
-                check(interr::OVERFLOW, true);
+                check(interr::OVERFLOW, true,
+                    !z3::bvadd_no_overflow(lhs_bv, rhs_bv, true) && !z3::bvadd_no_underflow(lhs_bv, rhs_bv));
             }
 
             break;
         case Instruction::Sub:
             if (!is_nsw) {
-                m_solver.value().add(!z3::bvsub_no_underflow(lhs_bv, rhs_bv, false));
-                check(interr::OVERFLOW, false);
+                check(interr::OVERFLOW, false, !z3::bvsub_no_underflow(lhs_bv, rhs_bv, false));
             } else {
-                m_solver.value().add(!z3::bvsub_no_underflow(lhs_bv, rhs_bv, true));
-                m_solver.value().add(!z3::bvsub_no_overflow(lhs_bv, rhs_bv));
-                check(interr::OVERFLOW, true);
+                check(interr::OVERFLOW, true,
+                    !z3::bvsub_no_underflow(lhs_bv, rhs_bv, true) && !z3::bvsub_no_overflow(lhs_bv, rhs_bv));
             }
 
             break;
         case Instruction::Mul:
             if (!is_nsw) {
-                m_solver.value().add(!z3::bvmul_no_overflow(lhs_bv, rhs_bv, false));
-                check(interr::OVERFLOW, false);
+                check(interr::OVERFLOW, false, !z3::bvmul_no_overflow(lhs_bv, rhs_bv, false));
             } else {
-                m_solver.value().add(!z3::bvmul_no_overflow(lhs_bv, rhs_bv, true));
-                m_solver.value().add(!z3::bvmul_no_underflow(lhs_bv, rhs_bv)); // INTMAX * -1
-                check(interr::OVERFLOW, true);
+                check(interr::OVERFLOW, true,
+                    !z3::bvmul_no_overflow(lhs_bv, rhs_bv, true)
+                        && !z3::bvmul_no_underflow(lhs_bv, rhs_bv)); // INTMAX * -1
             }
             break;
         case Instruction::URem:
         case Instruction::UDiv:
-            m_solver.value().add(rhs_bv == m_solver.value().ctx().bv_val(0, rhs_bits));
-            check(interr::DIV_BY_ZERO, false);
+            check(interr::DIV_BY_ZERO, false, rhs_bv == m_solver->bv_val(0, rhs_bits));
             break;
         case Instruction::SRem:
         case Instruction::SDiv: // can be overflow or divisor == 0
-            m_solver.value().push();
-            m_solver.value().add(rhs_bv == m_solver.value().ctx().bv_val(0, rhs_bits)); // may 0?
-            check(interr::DIV_BY_ZERO, true);
-            m_solver.value().pop();
-            m_solver.value().add(z3::bvsdiv_no_overflow(lhs_bv, rhs_bv));
-            check(interr::OVERFLOW, true);
+            check(interr::DIV_BY_ZERO, true, rhs_bv == m_solver->bv_val(0, rhs_bits)); // may 0?
+            check(interr::OVERFLOW, true, z3::bvsdiv_no_overflow(lhs_bv, rhs_bv));
             break;
         case Instruction::Shl:
         case Instruction::LShr:
         case Instruction::AShr:
-            m_solver.value().add(rhs_bv >= m_solver.value().ctx().bv_val(rhs_bits, rhs_bits)); // sat means bug
-            check(interr::BAD_SHIFT, false);
+            // sat means bug
+            check(interr::BAD_SHIFT, false, rhs_bv >= m_solver->bv_val(rhs_bits, rhs_bits));
             break;
         case Instruction::And:
         case Instruction::Or:
@@ -1175,13 +1736,15 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
         default:
             break;
         }
-        m_solver.value().pop();
     }
 
     z3::expr binary_op_propagate(BinaryOperator* op)
     {
-        const auto lhs = v2sym(op->getOperand(0));
-        const auto rhs = v2sym(op->getOperand(1));
+        return binary_op_propagate(op, v2sym(op->getOperand(0)), v2sym(op->getOperand(1)));
+    }
+
+    z3::expr binary_op_propagate(const BinaryOperator* op, const z3::expr& lhs, const z3::expr& rhs)
+    {
         switch (op->getOpcode()) {
         case Instruction::Add:
             return lhs + rhs;
@@ -1217,9 +1780,10 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
         return lhs; // dummy
     }
 
-    z3::expr cast_op_propagate(CastInst* op)
+    z3::expr cast_op_propagate(CastInst* op) { return cast_op_propagate(op, v2sym(op->getOperand(0))); }
+
+    z3::expr cast_op_propagate(const CastInst* op, const z3::expr& src)
     {
-        const auto src = v2sym(op->getOperand(0));
         const uint32_t bits = op->getType()->getIntegerBitWidth();
         switch (op->getOpcode()) {
         case CastInst::Trunc:
@@ -1232,8 +1796,405 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
             MKINT_WARN() << "Unhandled Cast Instruction " << op->getOpcodeName() << ". Using original range.";
         }
 
-        const std::string new_sym_str = "\%cast" + std::to_string(op->getValueID());
-        return m_solver.value().ctx().bv_const(new_sym_str.c_str(), bits); // new expr
+        return value_sym(op); // new expr
+    }
+
+    // The free bit-vector constant of `v`, created on first use. Symbols are numbered densely per function, so
+    // distinct values never share a constant and names are only built once.
+    z3::expr value_sym(const Value* v)
+    {
+        auto [it, inserted] = m_sym_ids.try_emplace(v, m_syms.size());
+        if (inserted) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "%%v%zu", m_syms.size());
+            m_syms.push_back(narrowed_const(v, name));
+        }
+        return m_syms[it->second];
+    }
+
+    // A constant of `v`'s width, or a narrower one zero- or sign-extended to it when the converged range of `v` (at
+    // its definition) fits. Terms keep the original width, so the overflow semantics of all operations are unchanged;
+    // the solver just bit-blasts fewer free bits.
+    z3::expr narrowed_const(const Value* v, const char* name)
+    {
+        const unsigned bits = v->getType()->getIntegerBitWidth();
+        if (!s_smt_narrow)
+            return m_solver->bv_const(name, bits);
+
+        const BasicBlock* def = nullptr;
+        if (auto arg = dyn_cast<Argument>(v))
+            def = &arg->getParent()->getEntryBlock();
+        else if (auto inst = dyn_cast<Instruction>(v))
+            def = inst->getParent();
+        if (!def)
+            return m_solver->bv_const(name, bits);
+
+        auto& rngs = m_func2range_info[def->getParent()][def];
+        auto rng = rngs.find(v);
+        if (rng == rngs.end() || rng->second.isEmptySet())
+            return m_solver->bv_const(name, bits);
+
+        const unsigned ubits = std::max(1u, rng->second.getActiveBits());
+        const unsigned sbits = rng->second.getMinSignedBits();
+        if (std::min(ubits, sbits) >= bits)
+            return m_solver->bv_const(name, bits);
+
+        ++m_n_narrowed;
+        if (ubits <= sbits)
+            return z3::zext(m_solver->bv_const(name, ubits), bits - ubits);
+        return z3::sext(m_solver->bv_const(name, sbits), bits - sbits);
+    }
+
+    // A callee without side effects that does not read memory: equal arguments give equal results.
+    bool is_pure(const Function* f)
+    {
+        if (auto it = m_pure_funcs.find(f); it != m_pure_funcs.end())
+            return it->second;
+
+        bool pure = f->doesNotAccessMemory();
+        if (!pure && !f->isDeclaration()) {
+            pure = std::all_of(inst_begin(f), inst_end(f),
+                [](const Instruction& i) { return !i.mayHaveSideEffects() && !i.mayReadFromMemory(); });
+        }
+        return m_pure_funcs[f] = pure;
+    }
+
+    // Results of pure callees with integer arguments are applications of an uninterpreted function, so identical
+    // calls agree; the callee's return range is asserted on every application. Small callees can be inlined instead.
+    z3::expr call_sym(const CallInst* call)
+    {
+        const Function* f = call->getCalledFunction();
+        if (!f || f->arg_empty() || !is_pure(f)
+            || !std::all_of(call->arg_begin(), call->arg_end(), [](const Use& u) { return u->getType()->isIntegerTy(); }))
+            return value_sym(call);
+
+        z3::expr_vector args(m_solver->ctx());
+        for (const auto& u : call->args())
+            args.push_back(v2sym(u.get()));
+
+        if (auto inlined = inline_call(f, args))
+            return inlined.value();
+
+        auto it = m_funcs.find(f);
+        if (it == m_funcs.end()) {
+            z3::sort_vector domain(m_solver->ctx());
+            for (const auto& arg : f->args())
+                domain.push_back(m_solver->ctx().bv_sort(arg.getType()->getIntegerBitWidth()));
+            char name[16];
+            std::snprintf(name, sizeof(name), "%%f%u", m_funcs.size());
+            const auto decl = m_solver->ctx().function(
+                name, domain, m_solver->ctx().bv_sort(f->getReturnType()->getIntegerBitWidth()));
+            it = m_funcs.try_emplace(f, decl).first;
+        }
+
+        const z3::expr app = it->second(args);
+        if (m_uf_apps.insert(app.id()).second) { // the summary holds on every path: no guard.
+            m_expr_syms.try_emplace(app.id(), app, symset_t {}); // keep `app` alive so that its id is not reused.
+            std::vector<z3::expr> summary;
+            if (auto rng = m_func2ret_range.find(f); rng != m_func2ret_range.end() && !rng->second.isFullSet()
+                && get_range_cons(rng->second, app, summary)) {
+                for (const auto& c : summary) {
+                    m_solver->add(c);
+                    m_facts.push_back(c);
+                }
+            }
+        }
+        return app;
+    }
+
+    // Symbolically evaluate a small single-block callee over `args`; nothing if it is not small or simple enough.
+    std::optional<z3::expr> inline_call(const Function* f, const z3::expr_vector& args)
+    {
+        if (f->isDeclaration() || f->size() != 1 || f->getEntryBlock().size() > s_smt_inline)
+            return std::nullopt;
+
+        DenseMap<const Value*, z3::expr> env;
+        for (const auto& arg : f->args())
+            env.try_emplace(&arg, args[arg.getArgNo()]);
+        const auto sym = [&env, this](const Value* v) -> std::optional<z3::expr> {
+            if (auto it = env.find(v); it != env.end())
+                return it->second;
+            if (auto c = dyn_cast<ConstantInt>(v))
+                return m_solver->bv_val(c->getZExtValue(), c->getType()->getIntegerBitWidth());
+            return std::nullopt;
+        };
+
+        for (const auto& inst : f->getEntryBlock()) {
+            if (auto ret = dyn_cast<ReturnInst>(&inst))
+                return sym(ret->getReturnValue());
+
+            std::optional<z3::expr> res;
+            if (auto op = dyn_cast<BinaryOperator>(&inst)) {
+                auto lhs = sym(op->getOperand(0)), rhs = sym(op->getOperand(1));
+                if (lhs && rhs)
+                    res = binary_op_propagate(op, lhs.value(), rhs.value());
+            } else if (auto op = dyn_cast<CastInst>(&inst); op && op->getSrcTy()->isIntegerTy()) {
+                auto src = sym(op->getOperand(0));
+                if (src && (isa<TruncInst>(op) || isa<ZExtInst>(op) || isa<SExtInst>(op)))
+                    res = cast_op_propagate(op, src.value());
+            }
+
+            if (!res)
+                return std::nullopt;
+            env.try_emplace(&inst, res.value());
+        }
+        return std::nullopt;
+    }
+
+    // Assertions are guarded by the literal of the innermost path frame. Instead of popping a frame, we simply stop
+    // assuming its literal so that the learned lemmas survive across sibling paths and checks.
+    z3::expr fresh_lit()
+    {
+        return m_solver->bool_const(m_n_lits++);
+    }
+
+    // Once nothing can assume `lit` any more (its check is solved, its frame is dead), `!lit` is asserted so that the
+    // solver drops what it guards. Deferred to the next query: asserting invalidates the model of the last one.
+    void retire(const z3::expr& lit) { m_retired.push_back(lit); }
+
+    void retire(const std::vector<path_cons>& cons)
+    {
+        for (const auto& c : cons)
+            retire(c.lit);
+    }
+
+    // A frame retires the literals of its constraints when the last path (or deferred check) through it is done.
+    std::shared_ptr<path_frame> new_frame(path_frame frame)
+    {
+        return std::shared_ptr<path_frame>(
+            new path_frame(std::move(frame)), [this, epoch = m_smt_epoch](path_frame* f) {
+                if (epoch == m_smt_epoch) // literal names restart with the solver.
+                    retire(f->cons);
+                delete f;
+            });
+    }
+
+    // bit-vector constants (by AST id) that `e` depends on.
+    const symset_t& symbols_of(const z3::expr& e)
+    {
+        if (auto it = m_expr_syms.find(e.id()); it != m_expr_syms.end())
+            return it->second.second;
+
+        symset_t syms;
+        if (e.is_const() && e.is_bv() && e.decl().decl_kind() == Z3_OP_UNINTERPRETED) {
+            syms.push_back(e.id());
+        } else if (e.is_app()) {
+            for (unsigned i = 0; i < e.num_args(); ++i) {
+                const auto& sub = symbols_of(e.arg(i));
+                syms.append(sub.begin(), sub.end());
+            }
+            llvm::sort(syms);
+            syms.erase(std::unique(syms.begin(), syms.end()), syms.end());
+        }
+
+        // keep `e` alive so that its id is not reused.
+        return m_expr_syms.try_emplace(e.id(), e, std::move(syms)).first->second.second;
+    }
+
+    // Every path constraint is guarded by its own literal; a query only assumes the constraints in the transitive
+    // dependency cone of the symbols it checks.
+    void smt_add(const z3::expr& e)
+    {
+        const auto lit = fresh_lit();
+        m_solver->add(z3::implies(lit, e));
+        m_path_cons.push_back({ lit, &symbols_of(e), e.id() });
+    }
+
+    z3::expr_vector path_cone(DenseSet<unsigned> syms)
+    {
+        z3::expr_vector assumptions(m_solver->ctx());
+        if (!s_smt_slice) {
+            for (const auto& c : m_path_cons)
+                assumptions.push_back(c.lit);
+            return assumptions;
+        }
+
+        const auto taken = cone_of(std::move(syms));
+        for (size_t i = 0; i < m_path_cons.size(); ++i)
+            if (taken[i])
+                assumptions.push_back(m_path_cons[i].lit);
+        return assumptions;
+    }
+
+    // which path constraints are in the transitive dependency cone of `syms`.
+    std::vector<bool> cone_of(DenseSet<unsigned> syms) const
+    {
+        std::vector<bool> taken(m_path_cons.size(), false);
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t i = m_path_cons.size(); i-- > 0;) {
+                const auto& csyms = *m_path_cons[i].syms;
+                if (taken[i]
+                    || (!csyms.empty() && std::none_of(csyms.begin(), csyms.end(), [&](auto s) {
+                           return syms.contains(s);
+                       })))
+                    continue;
+
+                taken[i] = changed = true;
+                syms.insert(csyms.begin(), csyms.end());
+            }
+        }
+        return taken;
+    }
+
+    // check the feasibility of the latest path constraint.
+    z3::check_result smt_check()
+    {
+        const auto& last = *m_path_cons.back().syms;
+        return smt_check(path_cone(DenseSet<unsigned>(last.begin(), last.end())));
+    }
+
+    // check the path condition together with `goal` (without keeping it).
+    z3::check_result smt_check(const z3::expr& goal) { return smt_check(goal, { goal }); }
+
+    // ditto, but the path condition is sliced to the cone of `seeds`.
+    z3::check_result smt_check(const z3::expr& goal, const std::vector<z3::expr>& seeds)
+    {
+        const auto lit = fresh_lit();
+        m_solver->add(z3::implies(lit, goal));
+
+        DenseSet<unsigned> syms;
+        for (const auto& s : seeds) {
+            const auto& ssyms = symbols_of(s);
+            syms.insert(ssyms.begin(), ssyms.end());
+        }
+
+        auto assumptions = path_cone(std::move(syms));
+        assumptions.push_back(lit);
+        const auto res = smt_check(assumptions);
+        retire(lit);
+        return res;
+    }
+
+    z3::check_result smt_check(const z3::expr_vector& assumptions)
+    {
+        unsigned timeout = s_smt_timeout;
+        bool by_budget = false; // the timeout is what is left of the module budget.
+        for (const auto& deadline : { m_smt_deadline, m_smt_budget_end }) {
+            if (!deadline.has_value())
+                continue;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline.value())
+                return z3::unknown; // per-function or module budget exhausted.
+
+            const unsigned left
+                = std::chrono::duration_cast<std::chrono::milliseconds>(deadline.value() - now).count() + 1;
+            if (!timeout || left < timeout) {
+                timeout = left;
+                by_budget = deadline == m_smt_budget_end;
+            }
+        }
+
+        for (const auto& lit : m_retired)
+            m_solver->retire(lit);
+        m_retired.clear();
+
+        m_solver->set_timeout(timeout);
+        const auto begin = std::chrono::steady_clock::now();
+        const auto res = m_solver->check(assumptions);
+        // Z3 may give up slightly before its timeout: a query that ran into the module budget spends what is left of
+        // it, rather than leaving a few ms to whichever query comes next.
+        const auto now = std::chrono::steady_clock::now();
+        if (res == z3::unknown && by_budget && 2 * (now - begin) >= std::chrono::milliseconds(timeout))
+            m_smt_budget_end = now;
+        return res;
+    }
+
+    void smt_reset()
+    {
+        m_solver->reset();
+        ++m_smt_epoch;
+        m_retired.clear();
+        m_path_cons.clear();
+        m_expr_syms.clear();
+        m_n_lits = 0;
+        m_sym_ids.clear();
+        m_syms.clear();
+        m_funcs.clear();
+        m_uf_apps.clear();
+        m_facts.clear();
+        m_explored.clear();
+        m_live_in.clear();
+    }
+
+    // Checks without a verdict: unknown ones were given up by the solver, unsolved ones were never tried because the
+    // module budget ran out. Both are annotated as unknown.
+    void report_unknowns()
+    {
+        const auto report = [this](const char* what, Instruction* inst, interr et) {
+            auto& confirmed = err_insts(et);
+
+            if (confirmed.count(inst)) // a counter example is found on another path.
+                return;
+
+            MKINT_WARN() << rang::fg::yellow << rang::style::bold << what << ' ' << mkstr(et) << rang::style::reset
+                         << " at " << rang::bg::black << rang::fg::red << inst->getFunction()->getName() << "::"
+                         << *inst << rang::style::reset;
+            mark_unknown(inst, et);
+            if (s_unknown_as_bug)
+                confirmed.insert(inst);
+        };
+
+        for (auto [inst, et] : m_unknown_checks)
+            report("unknown", inst, et);
+        for (auto [inst, et] : m_unsolved_checks) {
+            if (!m_unknown_checks.count({ inst, et }))
+                report("unsolved", inst, et);
+        }
+        for (auto F : m_unsolved_funcs)
+            MKINT_WARN() << rang::fg::yellow << "[SMT Solving] budget exhausted before solving " << F->getName()
+                         << rang::style::reset;
+    }
+
+    void clear_module_state()
+    {
+        m_func2tsrc.clear();
+        m_taint_funcs.clear();
+        m_backedges.clear();
+        m_callback_tsrc_fn.clear();
+
+        m_func2range_info.clear();
+        m_func2ret_range.clear();
+        m_range_analysis_funcs.clear();
+        m_func2exec_bbs.clear();
+        m_func2exec_edges.clear();
+        m_n_dead_bbs = 0;
+        m_summary = {};
+        m_global2range.clear();
+        m_garr2ranges.clear();
+
+        m_impossible_branches.clear();
+        m_gep_oob.clear();
+        m_overflow_insts.clear();
+        m_bad_shift_insts.clear();
+        m_div_zero_insts.clear();
+        m_unknown_checks.clear();
+        m_unsolved_checks.clear();
+        m_unsolved_funcs.clear();
+        m_func_spent.clear();
+        m_sink_dist.clear();
+        m_n_unsliced = 0;
+        m_n_subsumed = 0;
+        m_n_narrowed = 0;
+        m_n_branch_queries = 0;
+        m_n_branch_batches = 0;
+        m_cex.clear();
+
+        // expressions must not outlive the context.
+        m_retired.clear();
+        m_v2sym.clear();
+        m_bbpaths.clear();
+        m_path_cons.clear();
+        m_expr_syms.clear();
+        m_n_lits = 0;
+        m_sym_ids.clear();
+        m_syms.clear();
+        m_funcs.clear();
+        m_uf_apps.clear();
+        m_facts.clear();
+        m_explored.clear();
+        m_live_in.clear();
     }
 
     void mark_errors()
@@ -1269,7 +2230,7 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
 
         auto lconst = dyn_cast<ConstantInt>(v);
         MKINT_CHECK_ABORT(nullptr != lconst) << "unsupported value -> symbol mapping: " << *v;
-        return m_solver.value().ctx().bv_val(lconst->getZExtValue(), lconst->getType()->getIntegerBitWidth());
+        return m_solver->bv_val(lconst->getZExtValue(), lconst->getType()->getIntegerBitWidth());
     }
 
     void smt_solving(Module& M)
@@ -1280,8 +2241,12 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
 
             // Get a path tree.
             for (auto& bb : F->getBasicBlockList()) {
+                if (!is_executable(&bb)) {
+                    ++m_n_dead_bbs;
+                    continue;
+                }
                 for (const auto& pred : predecessors(&bb)) {
-                    if (m_backedges[&bb].contains(pred) || &bb == pred)
+                    if (m_backedges[&bb].contains(pred) || &bb == pred || !is_executable(pred))
                         continue;
 
                     m_bbpaths[pred].push_back(&bb);
@@ -1289,36 +2254,537 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
             }
         }
 
-        // solve constraints.
+        // riskiest functions are explored first, should the module budget run out.
+        std::vector<Function*> funcs;
         for (auto F : m_taint_funcs) {
-            if (F->isDeclaration())
+            if (!F->isDeclaration())
+                funcs.push_back(F);
+        }
+        if (s_smt_rank || s_sink_only)
+            compute_sink_dist(M);
+        DenseMap<const Function*, unsigned> scores; // of the riskiest check of a function.
+        if (s_smt_rank) {
+            for (auto F : funcs) {
+                unsigned score = 0;
+                for (auto& inst : instructions(F)) {
+                    if (auto op = dyn_cast<BinaryOperator>(&inst); op && op->getType()->isIntegerTy())
+                        score = std::max(score, check_score(op));
+                }
+                scores[F] = score;
+            }
+            std::stable_sort(funcs.begin(), funcs.end(),
+                [&scores](const Function* l, const Function* r) { return scores[l] > scores[r]; });
+        }
+
+        if (s_smt_budget)
+            m_smt_budget_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(s_smt_budget);
+
+        // One solver for the whole module: the literals and symbols of all functions are distinct, so the checks
+        // deferred by ranking can be solved in one queue across functions. A check is solved as soon as no function
+        // left to explore can outrank it, before their exploration (whose branch queries spend the budget too).
+        smt_reset();
+        for (size_t i = 0; i < funcs.size(); ++i) {
+            auto F = funcs[i];
+            if (budget_exhausted()) {
+                m_unsolved_funcs.push_back(F);
                 continue;
+            }
 
-            m_solver.value().push();
-            // add function arg constraints.
-            for (auto& arg : F->args()) {
-                if (!arg.getType()->isIntegerTy())
-                    continue;
-                const auto arg_name = F->getName() + "." + std::to_string(arg.getArgNo());
-                const auto argv
-                    = m_solver.value().ctx().bv_const(arg_name.str().c_str(), arg.getType()->getIntegerBitWidth());
-                m_v2sym[&arg] = argv;
-                add_range_cons(get_range_by_bb(&arg, &(F->getEntryBlock())), argv);
+            m_explored.clear();
+            m_live_in.clear();
+            with_func_budget(F, [this, F] {
+                // function arg constraints hold on every path: the root frame.
+                m_path_cons.clear();
+                auto root = new_frame({});
+                for (auto& arg : F->args()) {
+                    if (!arg.getType()->isIntegerTy())
+                        continue;
+                    const auto argv = value_sym(&arg);
+                    m_v2sym[&arg] = argv;
+                    root->bindings.emplace_back(&arg, argv);
+                    add_range_cons(get_range_by_bb(&arg, &(F->getEntryBlock())), argv);
+                }
+                root->cons = m_path_cons;
+                path_solving(&(F->getEntryBlock()), std::move(root));
+            });
+            if (s_smt_rank && i + 1 < funcs.size())
+                solve_pending(scores[funcs[i + 1]]);
+        }
+        solve_pending();
+        smt_reset(); // the assertions of this module are dead weight for the next.
+        m_smt_budget_end.reset();
+
+        MKINT_LOG() << "[SMT Solving] skipped " << m_n_dead_bbs << " blocks not executable under the ranges";
+        if (s_sink_only)
+            MKINT_LOG() << "[SMT Solving] skipped " << m_n_unsliced << " arithmetic instructions outside sink slices";
+        if (s_path_memo)
+            MKINT_LOG() << "[SMT Solving] pruned " << m_n_subsumed << " subsumed path subtrees";
+        if (s_smt_narrow)
+            MKINT_LOG() << "[SMT Solving] narrowed " << m_n_narrowed << " values";
+        MKINT_LOG() << "[SMT Solving] " << m_n_branch_queries << " branch queries in " << m_n_branch_batches
+                    << " batches";
+    }
+
+    // Runs `solve` within what is left of the `-mkint-smt-func-timeout` of `F`, which its exploration and the
+    // solving of its deferred checks share.
+    template <typename Fn> void with_func_budget(const Function* F, Fn&& solve)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        if (s_smt_func_timeout)
+            m_smt_deadline = func_deadline(F, start);
+        solve();
+        m_func_spent[F] += std::chrono::steady_clock::now() - start;
+        m_smt_deadline.reset();
+    }
+
+    std::chrono::steady_clock::time_point func_deadline(const Function* F, std::chrono::steady_clock::time_point now)
+    {
+        return now + std::chrono::milliseconds(s_smt_func_timeout) - m_func_spent[F];
+    }
+
+    bool budget_exhausted() const
+    {
+        return m_smt_budget_end.has_value() && std::chrono::steady_clock::now() >= m_smt_budget_end.value();
+    }
+
+    // Backward slice of the sinks of `M`, with the distance of every instruction in it to the nearest sink. An
+    // instruction depends on its operands, a load on the stores to the same object, and every instruction on the
+    // branches that may lead to its block. The slice follows direct calls both ways: an argument depends on the
+    // actual arguments of the call sites, an entry block on the call sites reaching it, and a call on the returns of
+    // its callee.
+    void compute_sink_dist(Module& M)
+    {
+        DenseMap<const Value*, std::vector<const Instruction*>> stores; // underlying object -> stores to it.
+        DenseMap<const Function*, std::vector<const Instruction*>> rets;
+        std::vector<const Instruction*> frontier;
+        for (auto& F : M) {
+            for (auto& inst : instructions(F)) {
+                if (auto store = dyn_cast<StoreInst>(&inst))
+                    stores[getUnderlyingObject(store->getPointerOperand())].push_back(store);
+                else if (isa<ReturnInst>(&inst))
+                    rets[&F].push_back(&inst);
+                if (inst.getMetadata(MKINT_IR_SINK)) {
+                    m_sink_dist[&inst] = 0;
+                    frontier.push_back(&inst);
+                }
+            }
+        }
+
+        const auto call_sites = [](const Function* F) {
+            std::vector<const CallBase*> calls;
+            for (auto user : F->users()) {
+                if (auto call = dyn_cast<CallBase>(user); call && call->getCalledFunction() == F)
+                    calls.push_back(call);
+            }
+            return calls;
+        };
+
+        DenseSet<const BasicBlock*> guarded;
+        DenseSet<const Argument*> args;
+        for (unsigned dist = 1; !frontier.empty(); ++dist) {
+            std::vector<const Instruction*> next;
+            const auto visit = [this, dist, &next, &args, &call_sites](const Value* v) {
+                if (auto inst = dyn_cast<Instruction>(v)) {
+                    if (m_sink_dist.try_emplace(inst, dist).second)
+                        next.push_back(inst);
+                } else if (auto arg = dyn_cast<Argument>(v); arg && args.insert(arg).second) {
+                    for (auto call : call_sites(arg->getParent())) {
+                        if (auto actual = dyn_cast<Instruction>(call->getArgOperand(arg->getArgNo()));
+                            actual && m_sink_dist.try_emplace(actual, dist).second)
+                            next.push_back(actual);
+                    }
+                }
+            };
+
+            for (auto inst : frontier) {
+                for (const auto& u : inst->operands())
+                    visit(u.get());
+                if (auto load = dyn_cast<LoadInst>(inst)) {
+                    if (auto it = stores.find(getUnderlyingObject(load->getPointerOperand())); it != stores.end()) {
+                        for (auto store : it->second)
+                            visit(store);
+                    }
+                }
+                if (auto call = dyn_cast<CallBase>(inst); call && call->getCalledFunction()) {
+                    if (auto it = rets.find(call->getCalledFunction()); it != rets.end()) {
+                        for (auto ret : it->second)
+                            visit(ret);
+                    }
+                }
+                if (guarded.insert(inst->getParent()).second) {
+                    for (auto pred : predecessors(inst->getParent()))
+                        visit(pred->getTerminator());
+                    if (inst->getParent()->isEntryBlock()) {
+                        for (auto call : call_sites(inst->getFunction()))
+                            visit(call);
+                    }
+                }
             }
+            frontier = std::move(next);
+        }
+    }
 
-            path_solving(&(F->getEntryBlock()), nullptr);
-            m_solver.value().pop();
+    // Cheap risk score of checking `op`: arithmetic close to a sink, over wide operands, and multiplications or
+    // shifts first.
+    unsigned check_score(const BinaryOperator* op)
+    {
+        unsigned score = 10;
+        switch (op->getOpcode()) {
+        case Instruction::Mul:
+        case Instruction::Shl:
+            score = 30;
+            break;
+        case Instruction::Add:
+        case Instruction::Sub:
+            score = 20;
+            break;
+        default:
+            break;
+        }
+
+        // bits of uncertainty of the operands, from the ranges of the block.
+        auto& rngs = m_func2range_info[op->getFunction()][op->getParent()];
+        for (const auto& u : op->operands()) {
+            if (isa<ConstantInt>(u.get()))
+                continue;
+            const unsigned bits = u->getType()->getIntegerBitWidth();
+            auto it = rngs.find(u.get());
+            const unsigned width = (it == rngs.end() || it->second.isFullSet())
+                ? bits
+                : (it->second.getUpper() - it->second.getLower()).getActiveBits();
+            score += width / 8;
         }
+
+        if (auto it = m_sink_dist.find(op); it != m_sink_dist.end())
+            score += 100 - 10 * std::min(it->second, 9u);
+        return score;
     }
 
-    void path_solving(BasicBlock* cur, BasicBlock* pred)
+    // With ranking, the checks of a block are deferred and solved riskiest first across the module, once no function
+    // left to explore can outrank them. The constraints of their path stay asserted (guarded) until then; the path
+    // is kept as the frame of their block, which shares its prefix with every other path through its ancestors.
+    void submit_checks(std::vector<bin_check>& checks, const std::shared_ptr<const path_frame>& frame)
     {
-        if (m_backedges[cur].contains(pred))
+        if (!s_smt_rank && !m_parallel) {
+            solve_checks(checks);
+            return;
+        }
+        if (checks.empty())
             return;
 
-        auto cur_brng = m_func2range_info[cur->getParent()][cur];
+        unsigned score = 0;
+        for (const auto& c : checks)
+            score = std::max(score, check_score(c.op));
+        const Function* func = checks.front().op->getFunction();
+        m_pending.push_back({ std::move(checks), frame, frame->cons.size(), func, score });
+        checks.clear();
+    }
 
+    // the path the checks of `p` were collected on.
+    void restore(const pending_checks& p)
+    {
+        restore(p.frame->parent);
+        m_restored.reset();
+        m_path_cons.insert(m_path_cons.end(), p.frame->cons.begin(), p.frame->cons.begin() + p.n_cons);
+    }
+
+    // Solves the pending checks scoring at least `min_score` (with ranking; all of them otherwise), riskiest first.
+    void solve_pending(unsigned min_score = 0)
+    {
+        auto end = m_pending.end();
+        if (s_smt_rank) {
+            std::stable_sort(m_pending.begin(), m_pending.end(),
+                [](const pending_checks& l, const pending_checks& r) { return l.score > r.score; });
+            end = llvm::find_if(m_pending, [min_score](const pending_checks& p) { return p.score < min_score; });
+        }
+        std::vector<pending_checks> pending(std::make_move_iterator(m_pending.begin()), std::make_move_iterator(end));
+        m_pending.erase(m_pending.begin(), end);
+        if (m_parallel) {
+            solve_pending_in_parallel(pending);
+            return;
+        }
+
+        for (auto& p : pending) {
+            if (budget_exhausted()) {
+                for (const auto& c : p.checks)
+                    m_unsolved_checks.emplace(c.op, c.et);
+                continue;
+            }
+
+            restore(p);
+            with_func_budget(p.func, [this, &p] { solve_checks(p.checks); });
+        }
+        m_restored.reset();
+    }
+
+    // Integer values used in the subtree of `bb` (along `m_bbpaths`) but defined outside of it.
+    const std::vector<const Value*>& live_in(const BasicBlock* bb)
+    {
+        if (auto it = m_live_in.find(bb); it != m_live_in.end())
+            return it->second;
+
+        SetVector<const Value*> uses;
+        for (auto succ : m_bbpaths[bb]) {
+            const auto& succ_uses = live_in(succ);
+            uses.insert(succ_uses.begin(), succ_uses.end());
+        }
+        for (const auto& inst : *bb) {
+            for (const auto& u : inst.operands()) {
+                if (u->getType()->isIntegerTy() && (isa<Instruction>(u.get()) || isa<Argument>(u.get())))
+                    uses.insert(u.get());
+            }
+        }
+        for (const auto& inst : *bb)
+            uses.remove(&inst);
+        return m_live_in[bb] = uses.takeVector();
+    }
+
+    // Whether the subtree of `bb` was explored under a weaker state: the same terms for the values it uses, and a
+    // subset of the current constraints over them. Every check in it is then at least as satisfiable there, so
+    // nothing new can be found; other constraints cannot affect it. Otherwise the current state is recorded.
+    bool subsumed(const BasicBlock* bb)
+    {
+        path_state state;
+        DenseSet<unsigned> syms;
+        for (auto v : live_in(bb)) {
+            auto it = m_v2sym.find(v);
+            if (it == m_v2sym.end() || !it->second.has_value())
+                continue;
+            state.bindings.emplace_back(v, it->second->id());
+            const auto& vsyms = symbols_of(it->second.value());
+            syms.insert(vsyms.begin(), vsyms.end());
+        }
+        llvm::sort(state.bindings);
+
+        const auto taken = cone_of(std::move(syms));
+        for (size_t i = 0; i < m_path_cons.size(); ++i) {
+            if (taken[i])
+                state.cons.push_back(m_path_cons[i].id);
+        }
+        llvm::sort(state.cons);
+        state.cons.erase(std::unique(state.cons.begin(), state.cons.end()), state.cons.end());
+
+        const size_t hash = hash_combine(bb, hash_combine_range(state.bindings.begin(), state.bindings.end()));
+        auto& explored = m_explored[hash];
+        for (const auto& [prev_bb, prev] : explored) {
+            if (prev_bb == bb && prev.bindings == state.bindings
+                && std::includes(state.cons.begin(), state.cons.end(), prev.cons.begin(), prev.cons.end())) {
+                ++m_n_subsumed;
+                return true;
+            }
+        }
+        explored.emplace_back(bb, std::move(state));
+        return false;
+    }
+
+    // Values of a switch condition taking the edge to `succ`, as one disjunction of sorted intervals: contiguous case
+    // values are merged and the default edge takes the gaps between all cases. A successor of several cases (and
+    // maybe of the default edge too) takes all of them.
+    z3::expr switch_edge_cons(const SwitchInst* swt, const BasicBlock* succ)
+    {
+        using interval = std::pair<APInt, APInt>; // closed, unsigned.
+        const auto merge = [](std::vector<interval> ivs) {
+            llvm::sort(ivs, [](const interval& l, const interval& r) { return l.first.ult(r.first); });
+            std::vector<interval> merged;
+            for (const auto& iv : ivs) {
+                if (merged.empty() || (!merged.back().second.isMaxValue() && iv.first.ugt(merged.back().second + 1))) {
+                    merged.push_back(iv);
+                } else if (iv.second.ugt(merged.back().second)) {
+                    merged.back().second = iv.second;
+                }
+            }
+            return merged;
+        };
+
+        const unsigned bits = swt->getCondition()->getType()->getIntegerBitWidth();
+        std::vector<interval> all, allowed;
+        for (auto c : swt->cases()) {
+            const auto& v = c.getCaseValue()->getValue();
+            all.emplace_back(v, v);
+            if (c.getCaseSuccessor() == succ)
+                allowed.emplace_back(v, v);
+        }
+
+        if (swt->getDefaultDest() == succ) {
+            APInt next = APInt::getMinValue(bits);
+            bool open = true; // `next` and above are not covered yet.
+            for (const auto& [lo, hi] : merge(std::move(all))) {
+                if (lo.ugt(next))
+                    allowed.emplace_back(next, lo - 1);
+                open = !hi.isMaxValue();
+                if (!open)
+                    break;
+                next = hi + 1;
+            }
+            if (open)
+                allowed.emplace_back(next, APInt::getMaxValue(bits));
+        }
+
+        const auto cond = v2sym(swt->getCondition());
+        const auto val = [this, bits](const APInt& v) { return m_solver->bv_val(v.getZExtValue(), bits); };
+        z3::expr_vector disj(m_solver->ctx());
+        for (const auto& [lo, hi] : merge(std::move(allowed))) {
+            if (lo == hi)
+                disj.push_back(cond == val(lo));
+            else if (lo.isMinValue() && hi.isMaxValue())
+                return m_solver->ctx().bool_val(true);
+            else if (lo.isMinValue())
+                disj.push_back(z3::ule(cond, val(hi)));
+            else if (hi.isMaxValue())
+                disj.push_back(z3::uge(cond, val(lo)));
+            else
+                disj.push_back(z3::uge(cond, val(lo)) && z3::ule(cond, val(hi)));
+        }
+        return disj.empty() ? m_solver->ctx().bool_val(false) : z3::mk_or(disj);
+    }
+
+    // Every pending batch becomes a task: its checks and the constraints of its path frame in their cone (plus the
+    // unguarded facts), so that it can be solved in any context.
+    void solve_pending_in_parallel(const std::vector<pending_checks>& pending)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<mkint::check_task> tasks;
+        for (auto& p : pending) {
+            mkint::check_task task { m_facts, {}, {}, std::nullopt };
+            if (s_smt_func_timeout)
+                task.deadline = func_deadline(p.func, now);
+            DenseSet<unsigned> syms;
+            for (const auto& c : p.checks) {
+                task.goals.push_back(c.query);
+                task.terms.push_back({ c.lhs, c.rhs });
+                const auto& csyms = symbols_of(c.query);
+                syms.insert(csyms.begin(), csyms.end());
+            }
+
+            restore(p);
+            const auto taken = s_smt_slice ? cone_of(std::move(syms)) : std::vector<bool>(m_path_cons.size(), true);
+            for (size_t i = 0; i < m_path_cons.size(); ++i) {
+                if (taken[i])
+                    task.facts.push_back(m_expr_syms.at(m_path_cons[i].id).first);
+            }
+            tasks.push_back(std::move(task));
+        }
+        m_restored.reset();
+
+        mkint::parallel_config config { s_smt_threads, s_smt_timeout, s_smt_rlimit, s_smt_batch, m_smt_budget_end };
+        const auto outcomes = mkint::solve_in_parallel(tasks, config);
+
+        for (size_t t = 0; t < tasks.size(); ++t) {
+            const auto& checks = pending[t].checks;
+            const auto& out = outcomes[t];
+            for (size_t i = 0; i < checks.size(); ++i) {
+                const auto& c = checks[i];
+                if (!out.started) {
+                    if (budget_exhausted())
+                        m_unsolved_checks.emplace(c.op, c.et);
+                    else
+                        report_check(c, z3::unknown);
+                } else if (out.verdicts[i] == z3::sat) {
+                    err_insts(c.et).insert(c.op);
+                    if (want_cex())
+                        m_cex.try_emplace({ c.op, c.et }, cex_t { out.values[i][0], out.values[i][1], c.is_signed });
+                } else if (out.verdicts[i] == z3::unknown) {
+                    report_check(c, z3::unknown);
+                }
+            }
+        }
+    }
+
+    // Paths are explored depth-first as resumable tasks rather than by recursion: a path entering a conditional
+    // branch is suspended until its edge is known to be feasible, and the queries of up to `-mkint-branch-batch`
+    // suspended paths are decided together (in parallel threads with `-mkint-smt-threads`). The exploration itself
+    // (encoding blocks, memoizing and resuming paths) stays on this thread: its state lives in one Z3 context.
+    void path_solving(BasicBlock* entry, std::shared_ptr<const path_frame> root)
+    {
+        m_ready.push_back({ entry, nullptr, std::move(root), false, {}, {} });
+        m_restored.reset();
+        while (!m_ready.empty() || !m_waiting.empty()) {
+            if (m_ready.empty() || m_waiting.size() >= std::max(1u, s_branch_batch.getValue())) {
+                decide_waiting();
+                continue;
+            }
+
+            auto t = std::move(m_ready.back());
+            m_ready.pop_back();
+            explore(t);
+        }
+        m_restored.reset();
+    }
+
+    // Replay `frame` (and its ancestors) into `m_path_cons` and `m_v2sym`, unless it is what they hold already.
+    void restore(const std::shared_ptr<const path_frame>& frame)
+    {
+        if (frame == m_restored)
+            return;
+
+        std::vector<const path_frame*> chain;
+        for (auto f = frame.get(); f; f = f->parent.get())
+            chain.push_back(f);
+
+        m_path_cons.clear();
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            m_path_cons.insert(m_path_cons.end(), (*it)->cons.begin(), (*it)->cons.end());
+            for (const auto& [v, e] : (*it)->bindings)
+                m_v2sym[v] = e;
+        }
+        m_restored = frame;
+    }
+
+    void decide_waiting()
+    {
+        auto waiting = std::move(m_waiting);
+        m_waiting.clear();
+        ++m_n_branch_batches;
+        m_n_branch_queries += waiting.size();
+
+        std::vector<z3::check_result> verdicts;
+        if (m_parallel && waiting.size() > 1) {
+            std::vector<mkint::check_task> tasks;
+            for (const auto& t : waiting) {
+                mkint::check_task task { m_facts, { m_solver->ctx().bool_val(true) }, { {} }, std::nullopt };
+                for (const auto& c : t.cone)
+                    task.facts.push_back(m_expr_syms.at(c.id).first);
+                tasks.push_back(std::move(task));
+            }
+
+            mkint::parallel_config config { s_smt_threads, s_smt_timeout, s_smt_rlimit, false, m_smt_budget_end };
+            if (m_smt_deadline.has_value() && (!config.deadline.has_value() || m_smt_deadline < config.deadline))
+                config.deadline = m_smt_deadline;
+            for (const auto& out : mkint::solve_in_parallel(tasks, config))
+                verdicts.push_back(out.started ? out.verdicts.front() : z3::unknown);
+        } else {
+            for (const auto& t : waiting) {
+                z3::expr_vector assumptions(m_solver->ctx());
+                for (const auto& c : t.cone)
+                    assumptions.push_back(c.lit);
+                m_solver->set_tag({ t.pred->getTerminator(), "branch" });
+                verdicts.push_back(smt_check(assumptions));
+            }
+        }
+
+        // resumed in the order they were suspended.
+        for (size_t i = waiting.size(); i-- > 0;) {
+            auto& t = waiting[i];
+            if (verdicts[i] == z3::unsat) { // unknown: conservatively keep exploring this branch.
+                const auto br = cast<BranchInst>(t.pred->getTerminator());
+                MKINT_WARN() << "[SMT Solving] cannot continue " << (br->getSuccessor(0) == t.cur ? "true" : "false")
+                             << " branch of " << *br->getCondition();
+                retire(t.edge.cons);
+                continue;
+            }
+            t.feasible = true;
+            t.cone.clear();
+            m_ready.push_back(std::move(t));
+        }
+    }
+
+    // Whether `t` may enter its block; if its edge has to be decided first, it is suspended into `m_waiting`.
+    bool enter_edge(path_task& t)
+    {
+        BasicBlock* cur = t.cur;
+        BasicBlock* pred = t.pred;
         if (nullptr != pred) {
+            // at a conditional branch, the path is suspended until its edge is known to be feasible.
             if (auto terminator = pred->getTerminator(); auto br = dyn_cast<BranchInst>(terminator)) {
                 if (br->isConditional()) {
                     if (auto cmp = dyn_cast<ICmpInst>(br->getCondition())) {
@@ -1334,7 +2800,7 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                             bool is_true_br = br->getSuccessor(0) == cur;
 
                             if (m_impossible_branches.count(cmp) && m_impossible_branches[cmp] == is_true_br) {
-                                return;
+                                return false;
                             }
 
                             const auto get_tbr_assert = [lhs, rhs, cmp, this]() {
@@ -1366,88 +2832,105 @@ struct MKintPass : public PassInfoMixin<MKintPass> {
                                 MKINT_CHECK_ABORT(false) << "unsupported icmp predicate: " << *cmp;
                             };
 
-                            const auto check = [cmp, is_true_br, this] {
-                                if (m_solver.value().check() == z3::unsat) { // counter example
-                                    MKINT_WARN() << "[SMT Solving] cannot continue " << (is_true_br ? "true" : "false")
-                                                 << " branch of " << *cmp;
-                                    return false;
-                                }
-                                return true;
-                            };
-
-                            if (is_true_br) { // T branch
-                                m_solver.value().add(get_tbr_assert());
-                                if (!check())
-                                    return;
-                                m_v2sym[cmp] = m_solver.value().ctx().bv_val(true, 1);
-                            } else { // F branch
-                                m_solver.value().add(!get_tbr_assert());
-                                if (!check())
-                                    return;
-                                m_v2sym[cmp] = m_solver.value().ctx().bv_val(false, 1);
+                            const size_t n_cons = m_path_cons.size();
+                            smt_add(is_true_br ? get_tbr_assert() : !get_tbr_assert());
+                            const auto& last = *m_path_cons.back().syms;
+                            const auto taken = s_smt_slice ? cone_of(DenseSet<unsigned>(last.begin(), last.end()))
+                                                           : std::vector<bool>(m_path_cons.size(), true);
+                            for (size_t i = 0; i < m_path_cons.size(); ++i) {
+                                if (taken[i])
+                                    t.cone.push_back(m_path_cons[i]);
                             }
+                            t.edge.cons.assign(m_path_cons.begin() + n_cons, m_path_cons.end());
+                            t.edge.bindings.emplace_back(cmp, m_solver->bv_val(is_true_br, 1));
+                            m_waiting.push_back(std::move(t));
+                            return false;
                         }
                     }
                 }
             } else if (auto swt = dyn_cast<SwitchInst>(terminator)) {
-                auto cond = swt->getCondition();
-                if (cond->getType()->isIntegerTy()) {
-                    auto cond_rng = get_range_by_bb(cond, pred);
-                    auto emp_rng = crange::getEmpty(cond->getType()->getIntegerBitWidth());
-
-                    if (swt->getDefaultDest() == cur) { // default
-                        // not (all)
-                        for (auto c : swt->cases()) {
-                            auto case_val = c.getCaseValue();
-                            m_solver.value().add(v2sym(cond)
-                                != m_solver.value().ctx().bv_val(
-                                    case_val->getZExtValue(), cond->getType()->getIntegerBitWidth()));
-                        }
-                    } else {
-                        for (auto c : swt->cases()) {
-                            if (c.getCaseSuccessor() == cur) {
-                                auto case_val = c.getCaseValue();
-                                m_solver.value().add(v2sym(cond)
-                                    == m_solver.value().ctx().bv_val(
-                                        case_val->getZExtValue(), cond->getType()->getIntegerBitWidth()));
-                                break;
-                            }
-                        }
-                    }
-                }
+                if (swt->getCondition()->getType()->isIntegerTy())
+                    smt_add(switch_edge_cons(swt, cur));
             } else {
                 // try catch... (thank god, C does not have try-catch)
                 // indirectbr... ?
                 MKINT_CHECK_ABORT(false) << "Unknown terminator: " << *pred->getTerminator();
             }
         }
+        return true;
+
+    }
+
+    void explore(path_task& t)
+    {
+        BasicBlock* cur = t.cur;
+        if (m_backedges[cur].contains(t.pred)) {
+            retire(t.edge.cons);
+            return;
+        }
+
+        restore(t.frame);
+        m_restored.reset(); // `m_path_cons` grows past the frame from here on.
+        const size_t n_path = m_path_cons.size();
+        if (t.feasible) {
+            m_path_cons.insert(m_path_cons.end(), t.edge.cons.begin(), t.edge.cons.end());
+            for (const auto& [v, e] : t.edge.bindings)
+                m_v2sym[v] = e;
+        } else if (!enter_edge(t)) {
+            return;
+        }
+
+        auto cur_brng = m_func2range_info[cur->getParent()][cur];
+
+        if (s_path_memo && subsumed(cur)) {
+            retire({ m_path_cons.begin() + n_path, m_path_cons.end() });
+            return;
+        }
 
+        // created before the block is encoded: the checks of the block refer to it for the path into it.
+        auto frame
+            = new_frame({ t.frame, { m_path_cons.begin() + n_path, m_path_cons.end() }, std::move(t.edge.bindings) });
+        const auto bind = [this, &frame](const Value* v, const z3::expr& e) {
+            m_v2sym[v] = e;
+            frame->bindings.emplace_back(v, e);
+        };
+
+        // range constraints of this block are asserted after its checks are solved.
+        std::vector<z3::expr> block_cons;
+        std::vector<bin_check> checks;
         for (auto& inst : cur->getInstList()) {
             if (!cur_brng.count(&inst) || !inst.getType()->isIntegerTy())
                 continue;
 
             if (auto op = dyn_cast<BinaryOperator>(&inst)) {
-                binary_check(op);
-                m_v2sym[op] = binary_op_propagate(op);
-                if (!add_range_cons(get_range_by_bb(&inst, inst.getParent()), v2sym(op)))
-                    return;
+                if (!s_sink_only || m_sink_dist.count(op))
+                    binary_check(op, block_cons, checks);
+                else
+                    ++m_n_unsliced;
+                bind(op, binary_op_propagate(op));
             } else if (auto op = dyn_cast<CastInst>(&inst)) {
-                m_v2sym[op] = cast_op_propagate(op);
-                if (!add_range_cons(get_range_by_bb(&inst, inst.getParent()), v2sym(op)))
-                    return;
+                bind(op, cast_op_propagate(op));
+            } else if (auto call = dyn_cast<CallInst>(&inst)) {
+                bind(call, call_sym(call));
             } else {
-                const auto name = "\%vid" + std::to_string(inst.getValueID());
-                m_v2sym[&inst] = m_solver.value().ctx().bv_const(name.c_str(), inst.getType()->getIntegerBitWidth());
-                if (!add_range_cons(get_range_by_bb(&inst, inst.getParent()), v2sym(&inst)))
-                    return;
+                bind(&inst, value_sym(&inst));
             }
-        }
 
-        for (auto succ : m_bbpaths[cur]) {
-            m_solver.value().push();
-            path_solving(succ, cur);
-            m_solver.value().pop();
+            if (!get_range_cons(get_range_by_bb(&inst, inst.getParent()), v2sym(&inst), block_cons)) {
+                submit_checks(checks, frame);
+                return;
+            }
         }
+
+        submit_checks(checks, frame);
+        for (const auto& c : block_cons)
+            smt_add(c);
+
+        frame->cons.assign(m_path_cons.begin() + n_path, m_path_cons.end());
+        m_restored = frame;
+        const auto& succs = m_bbpaths[cur];
+        for (auto it = succs.rbegin(); it != succs.rend(); ++it) // the first successor is explored first.
+            m_ready.push_back({ *it, cur, frame, false, {}, {} });
     }
 
 private:
@@ -1460,6 +2943,10 @@ private:
     std::map<const Function*, bbrange_t> m_func2range_info;
     std::map<const Function*, crange> m_func2ret_range;
     SetVector<Function*> m_range_analysis_funcs;
+    std::map<const Function*, SmallPtrSet<const BasicBlock*, 16>> m_func2exec_bbs;
+    std::map<const Function*, DenseSet<std::pair<const BasicBlock*, const BasicBlock*>>> m_func2exec_edges;
+    size_t m_n_dead_bbs = 0; // of the tainted functions, skipped by the solving.
+    mkint::module_summary m_summary; // of the whole program, from `-mkint-summary-in`.
     std::map<const GlobalVariable*, crange> m_global2range;
     std::map<const GlobalVariable*, SmallVector<crange, 4>> m_garr2ranges;
 
@@ -1469,9 +2956,41 @@ private:
     std::set<Instruction*> m_overflow_insts;
     std::set<Instruction*> m_bad_shift_insts;
     std::set<Instruction*> m_div_zero_insts;
+    std::set<std::pair<Instruction*, interr>> m_unknown_checks;
+    std::set<std::pair<Instruction*, interr>> m_unsolved_checks; // skipped once the module budget ran out.
+    std::vector<const Function*> m_unsolved_funcs;
+    std::map<std::pair<Instruction*, interr>, cex_t> m_cex; // the first counter example of each bug.
 
     // constraint solving
-    std::optional<z3::solver> m_solver;
+    std::unique_ptr<mkint::smt_backend> m_solver;
+    std::optional<std::chrono::steady_clock::time_point> m_smt_deadline;
+    std::optional<std::chrono::steady_clock::time_point> m_smt_budget_end;
+    DenseMap<const Instruction*, unsigned> m_sink_dist; // the backward slices of the sinks.
+    size_t m_n_unsliced = 0; // arithmetic not checked with `-mkint-sink-only`.
+    std::vector<pending_checks> m_pending; // checks of the module waiting to be solved.
+    DenseMap<const Function*, std::chrono::steady_clock::duration> m_func_spent; // SMT time, per function.
+    std::vector<path_task> m_ready; // paths to explore; a stack, so the exploration is depth-first.
+    std::vector<path_task> m_waiting; // paths suspended at a branch feasibility query.
+    std::shared_ptr<const path_frame> m_restored; // the frame `m_path_cons` and `m_v2sym` currently hold.
+    size_t m_n_branch_queries = 0;
+    size_t m_n_branch_batches = 0;
+    std::vector<z3::expr> m_facts; // unguarded assertions of the module.
+    bool m_parallel = false; // solve `m_pending` with `mkint::solve_in_parallel`.
+    // (block, branch bindings) hash -> path states the block was explored under; per function.
+    std::unordered_map<size_t, std::vector<std::pair<const BasicBlock*, path_state>>> m_explored;
+    DenseMap<const BasicBlock*, std::vector<const Value*>> m_live_in; // values a subtree uses but does not define.
+    size_t m_n_subsumed = 0;
+    size_t m_n_narrowed = 0; // values encoded with fewer bits than their type.
+    std::vector<path_cons> m_path_cons; // constraints of the current path.
+    std::vector<z3::expr> m_retired; // literals to retire before the next query.
+    unsigned m_smt_epoch = 0; // bumped by every solver reset.
+    std::unordered_map<unsigned, std::pair<z3::expr, symset_t>> m_expr_syms;
+    int m_n_lits = 0;
+    DenseMap<const Value*, unsigned> m_sym_ids; // value -> index of its constant in `m_syms`; per module.
+    std::vector<z3::expr> m_syms;
+    DenseMap<const Function*, z3::func_decl> m_funcs; // uninterpreted function of each pure callee; per module.
+    DenseSet<unsigned> m_uf_apps; // applications whose return range summary is asserted.
+    DenseMap<const Function*, bool> m_pure_funcs;
     DenseMap<const Value*, std::optional<z3::expr>> m_v2sym;
     std::map<const BasicBlock*, SmallVector<BasicBlock*, 2>> m_bbpaths;
 };
@@ -0,0 +1,163 @@
+// Replays SMT-LIB2 queries dumped by `-mkint-smt-dump` and reports solving time statistics, so that solver
+// settings can be benchmarked without re-running the analysis.
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <z3++.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<std::string> s_inputs(cl::Positional, cl::desc("<.smt2 files or directories>"), cl::OneOrMore);
+static cl::opt<unsigned> s_timeout("timeout", cl::desc("Timeout (ms) of a single query; 0 means no limit"),
+    cl::init(0));
+static cl::opt<unsigned> s_repeat("repeat", cl::desc("Solve every query this many times"), cl::init(1));
+
+namespace {
+
+struct query_result {
+    std::string path;
+    std::string kind;
+    std::string verdict; // verdict recorded by the pass.
+    std::string replayed;
+    double ms;
+};
+
+// value of a `; key: value` header line written by the dumper.
+std::string header(StringRef text, StringRef key)
+{
+    const std::string prefix = ("; " + key + ": ").str();
+    SmallVector<StringRef, 8> lines;
+    text.split(lines, '\n');
+    for (auto line : lines) {
+        if (!line.startswith(";"))
+            break;
+        if (line.startswith(prefix))
+            return line.drop_front(prefix.size()).trim().str();
+    }
+    return "";
+}
+
+const char* verdict_str(z3::check_result res)
+{
+    return res == z3::sat ? "sat" : res == z3::unsat ? "unsat" : "unknown";
+}
+
+void collect(StringRef input, std::vector<std::string>& files)
+{
+    if (!sys::fs::is_directory(input)) {
+        files.push_back(input.str());
+        return;
+    }
+
+    std::error_code ec;
+    for (sys::fs::directory_iterator it(input, ec), end; it != end && !ec; it.increment(ec)) {
+        if (StringRef(it->path()).endswith(".smt2"))
+            files.push_back(it->path());
+    }
+    if (ec)
+        errs() << "cannot read " << input << ": " << ec.message() << '\n';
+}
+
+void print_stats(StringRef name, std::vector<double> ms)
+{
+    if (ms.empty())
+        return;
+
+    std::sort(ms.begin(), ms.end());
+    const auto pct = [&ms](double p) { return ms[std::min(ms.size() - 1, size_t(p * ms.size()))]; };
+    double total = 0;
+    for (auto t : ms)
+        total += t;
+
+    outs() << format("%-24s %8zu %12.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name.str().c_str(), ms.size(), total,
+        ms.front(), pct(0.5), pct(0.9), pct(0.99), ms.back());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    cl::ParseCommandLineOptions(argc, argv, "MiniKint SMT query replay\n");
+
+    std::vector<std::string> files;
+    for (const auto& input : s_inputs)
+        collect(input, files);
+    std::sort(files.begin(), files.end());
+
+    std::vector<query_result> results;
+    size_t n_malformed = 0;
+    for (const auto& path : files) {
+        auto buf = MemoryBuffer::getFile(path);
+        if (!buf) {
+            errs() << "cannot read " << path << ": " << buf.getError().message() << '\n';
+            continue;
+        }
+
+        query_result r { path, header((*buf)->getBuffer(), "kind"), header((*buf)->getBuffer(), "verdict"), "", 0 };
+        if (r.kind.empty())
+            r.kind = "query";
+
+        bool malformed = false;
+        for (unsigned i = 0; i < std::max(1u, s_repeat.getValue()) && !malformed; ++i) {
+            // a fresh context per run: nothing is learnt across queries.
+            z3::context ctx;
+            // parse errors are checked below rather than thrown, as in the solver worker.
+            ctx.set_enable_exceptions(false);
+            z3::solver solver(ctx);
+            if (s_timeout)
+                solver.set("timeout", s_timeout.getValue());
+            solver.from_file(path.c_str());
+            if (Z3_get_error_code(ctx) != Z3_OK) {
+                errs() << "malformed query: " << path << ": " << StringRef(Z3_get_error_msg(ctx, Z3_get_error_code(ctx))).trim()
+                       << '\n';
+                malformed = true;
+                break;
+            }
+
+            const auto begin = std::chrono::steady_clock::now();
+            const auto res = solver.check();
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+            r.ms += elapsed.count();
+            r.replayed = verdict_str(res);
+        }
+        if (malformed) {
+            ++n_malformed;
+            continue;
+        }
+        r.ms /= std::max(1u, s_repeat.getValue());
+        results.push_back(std::move(r));
+    }
+
+    std::vector<double> all;
+    std::map<std::string, std::vector<double>> by_kind;
+    size_t n_mismatch = 0;
+    for (const auto& r : results) {
+        all.push_back(r.ms);
+        by_kind[r.kind].push_back(r.ms);
+        // an unknown on either side is a budget difference rather than a disagreement.
+        if (!r.verdict.empty() && r.verdict != "unknown" && r.replayed != "unknown" && r.verdict != r.replayed) {
+            ++n_mismatch;
+            errs() << "verdict mismatch: " << r.path << " (recorded " << r.verdict << ", replayed " << r.replayed
+                   << ")\n";
+        }
+    }
+
+    outs() << "kind                        count    total(ms)        min        p50        p90        p99        max\n";
+    for (const auto& [kind, ms] : by_kind)
+        print_stats(kind, ms);
+    print_stats("all", all);
+
+    return n_mismatch || n_malformed ? 1 : 0;
+}
@@ -0,0 +1,1198 @@
+#include "smt.hpp"
+#include "log.hpp"
+#include "worker.hpp"
+
+#include <llvm/ADT/APInt.h>
+#include <llvm/IR/ConstantRange.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace llvm;
+
+mkint::smt_session::smt_session(unsigned rlimit)
+    : m_rlimit(rlimit)
+{
+}
+
+mkint::smt_session::~smt_session() { release(); }
+
+z3::context& mkint::smt_session::ctx()
+{
+    if (!m_ctx)
+        m_ctx = std::make_unique<z3::context>();
+    return *m_ctx;
+}
+
+z3::solver& mkint::smt_session::solver()
+{
+    if (!m_solver) {
+        m_solver = std::make_unique<z3::solver>(ctx());
+        configure();
+    }
+    return *m_solver;
+}
+
+void mkint::smt_session::set_timeout(unsigned timeout)
+{
+    if (m_timeout.has_value() && m_timeout.value() == timeout)
+        return;
+
+    z3::params p(ctx());
+    // Z3 treats UINT_MAX as "no timeout".
+    p.set("timeout", timeout ? timeout : std::numeric_limits<unsigned>::max());
+    solver().set(p);
+    m_timeout = timeout;
+}
+
+void mkint::smt_session::reset()
+{
+    if (!m_solver)
+        return;
+
+    m_solver->reset();
+    configure();
+}
+
+void mkint::smt_session::release()
+{
+    // the solver refers to the context: destroy it first.
+    m_solver.reset();
+    m_ctx.reset();
+    m_timeout.reset();
+}
+
+void mkint::smt_session::configure()
+{
+    m_timeout.reset();
+    if (m_rlimit) {
+        z3::params p(ctx());
+        p.set("rlimit", m_rlimit);
+        m_solver->set(p);
+    }
+}
+
+APInt mkint::numeral_of(const z3::expr& e)
+{
+    const unsigned bits = e.get_sort().bv_size();
+    if (bits <= 64)
+        return APInt(bits, e.get_numeral_uint64());
+    return APInt(bits, Z3_get_numeral_string(e.ctx(), e), 10);
+}
+
+mkint::smt_backend::smt_backend(std::shared_ptr<smt_session> session)
+    : m_session(std::move(session))
+{
+}
+
+namespace {
+
+using mkint::smt_backend;
+using mkint::smt_session;
+
+class z3_backend final : public smt_backend {
+public:
+    using smt_backend::smt_backend;
+
+    const char* name() const override { return "z3"; }
+    void add(const z3::expr& e) override { m_session->solver().add(e); }
+    z3::check_result check(const z3::expr_vector& assumptions) override
+    {
+        return m_session->solver().check(assumptions);
+    }
+    z3::model get_model() override { return m_session->solver().get_model(); }
+}; // class z3_backend
+
+using ovf = ConstantRange::OverflowResult;
+
+// Decides a query by interval reasoning over the asserted constraints: bounds of bit-vector constants are collected
+// from the active facts, and a fact that evaluates to false under these bounds makes the query unsat. Intervals
+// over-approximate, so a query is never answered sat; undecided ones go to the fallback (or become unknown).
+class interval_backend final : public smt_backend {
+public:
+    interval_backend(std::shared_ptr<smt_session> session, std::unique_ptr<smt_backend> fallback)
+        : smt_backend(std::move(session))
+        , m_fallback(std::move(fallback))
+    {
+    }
+
+    const char* name() const override { return m_fallback ? "hybrid" : "interval"; }
+
+    void add(const z3::expr& e) override
+    {
+        if (e.is_app() && e.decl().decl_kind() == Z3_OP_IMPLIES && is_lit(e.arg(0))) {
+            auto& facts = m_guarded[e.arg(0).id()];
+            if (facts.empty())
+                m_lits.push_back(e.arg(0));
+            facts.push_back(e.arg(1));
+        } else {
+            m_facts.push_back(e);
+        }
+
+        if (m_fallback)
+            m_fallback->add(e);
+    }
+
+    void retire(const z3::expr& lit) override
+    {
+        m_guarded.erase(lit.id()); // `lit` stays in `m_lits`.
+        if (m_fallback)
+            m_fallback->retire(lit);
+    }
+
+    z3::check_result check(const z3::expr_vector& assumptions) override
+    {
+        ++m_n_queries;
+        if (decide_unsat(assumptions)) {
+            ++m_n_resolved;
+            return z3::unsat;
+        }
+        return m_fallback ? m_fallback->check(assumptions) : z3::unknown;
+    }
+
+    z3::model get_model() override
+    {
+        MKINT_CHECK_ABORT(nullptr != m_fallback) << "interval backend does not produce models";
+        return m_fallback->get_model();
+    }
+
+    void set_timeout(unsigned timeout) override
+    {
+        if (m_fallback)
+            m_fallback->set_timeout(timeout);
+    }
+
+    void reset() override
+    {
+        m_facts.clear();
+        m_guarded.clear();
+        m_lits.clear();
+        if (m_fallback)
+            m_fallback->reset();
+        else
+            smt_backend::reset();
+    }
+
+    std::string stats() const override
+    {
+        return "interval reasoning resolved " + std::to_string(m_n_resolved) + " of " + std::to_string(m_n_queries)
+            + " queries";
+    }
+
+private:
+    static bool is_lit(const z3::expr& e)
+    {
+        return e.is_const() && e.is_bool() && e.decl().decl_kind() == Z3_OP_UNINTERPRETED;
+    }
+
+    static unsigned bits(const z3::expr& e) { return e.get_sort().bv_size(); }
+
+    static ConstantRange full(const z3::expr& e) { return ConstantRange::getFull(bits(e)); }
+
+
+    static void flatten(const z3::expr& e, std::vector<z3::expr>& out)
+    {
+        if (e.is_app() && e.decl().decl_kind() == Z3_OP_AND) {
+            for (unsigned i = 0; i < e.num_args(); ++i)
+                flatten(e.arg(i), out);
+        } else {
+            out.push_back(e);
+        }
+    }
+
+    // state of a single query.
+    struct query {
+        std::unordered_set<unsigned> assumed;
+        std::unordered_map<unsigned, ConstantRange> bounds; // bit-vector constant -> range
+        std::unordered_map<unsigned, ConstantRange> bv_memo;
+        std::unordered_map<unsigned, std::optional<bool>> bool_memo;
+    };
+
+    bool decide_unsat(const z3::expr_vector& assumptions)
+    {
+        query q;
+        std::vector<z3::expr> active;
+        for (const auto& f : m_facts)
+            flatten(f, active);
+        for (const auto& a : assumptions) {
+            q.assumed.insert(a.id());
+            if (auto it = m_guarded.find(a.id()); it != m_guarded.end())
+                for (const auto& f : it->second)
+                    flatten(f, active);
+        }
+
+        for (const auto& f : active)
+            if (!collect_bound(q, f))
+                return true; // empty range.
+
+        for (const auto& f : active)
+            if (eval_bool(q, f) == false)
+                return true;
+
+        return false;
+    }
+
+    // bounds of the shape `x op c` or `c op x` where x is a constant.
+    static bool collect_bound(query& q, const z3::expr& f)
+    {
+        if (!f.is_app() || f.num_args() != 2 || !f.arg(0).is_bv())
+            return true;
+
+        auto x = f.arg(0), c = f.arg(1);
+        auto pred = [&]() -> std::optional<CmpInst::Predicate> {
+            switch (f.decl().decl_kind()) {
+            case Z3_OP_EQ:
+                return CmpInst::ICMP_EQ;
+            case Z3_OP_ULEQ:
+                return CmpInst::ICMP_ULE;
+            case Z3_OP_ULT:
+                return CmpInst::ICMP_ULT;
+            case Z3_OP_UGEQ:
+                return CmpInst::ICMP_UGE;
+            case Z3_OP_UGT:
+                return CmpInst::ICMP_UGT;
+            case Z3_OP_SLEQ:
+                return CmpInst::ICMP_SLE;
+            case Z3_OP_SLT:
+                return CmpInst::ICMP_SLT;
+            case Z3_OP_SGEQ:
+                return CmpInst::ICMP_SGE;
+            case Z3_OP_SGT:
+                return CmpInst::ICMP_SGT;
+            default:
+                return std::nullopt;
+            }
+        }();
+
+        if (!pred.has_value())
+            return true;
+
+        if (x.is_numeral()) {
+            std::swap(x, c);
+            pred = CmpInst::getSwappedPredicate(pred.value());
+        }
+
+        if (!c.is_numeral() || !x.is_const() || x.decl().decl_kind() != Z3_OP_UNINTERPRETED)
+            return true;
+
+        const auto region = ConstantRange::makeSatisfyingICmpRegion(pred.value(), ConstantRange(mkint::numeral_of(c)));
+        auto it = q.bounds.try_emplace(x.id(), full(x)).first;
+        it->second = it->second.intersectWith(region);
+        return !it->second.isEmptySet();
+    }
+
+    std::optional<bool> eval_bool(query& q, const z3::expr& e)
+    {
+        if (auto it = q.bool_memo.find(e.id()); it != q.bool_memo.end())
+            return it->second;
+
+        q.bool_memo[e.id()] = std::nullopt; // breaks cycles among guarded literals.
+        const auto ret = eval_bool_impl(q, e);
+        q.bool_memo[e.id()] = ret;
+        return ret;
+    }
+
+    std::optional<bool> eval_bool_impl(query& q, const z3::expr& e)
+    {
+        if (is_lit(e)) {
+            if (q.assumed.count(e.id()))
+                return true;
+            // a literal guarding a false fact must be false.
+            if (auto it = m_guarded.find(e.id()); it != m_guarded.end())
+                for (const auto& f : it->second)
+                    if (eval_bool(q, f) == false)
+                        return false;
+            return std::nullopt;
+        }
+
+        if (!e.is_app())
+            return std::nullopt;
+
+        const auto not_ = [](std::optional<bool> v) -> std::optional<bool> {
+            if (v.has_value())
+                return !v.value();
+            return std::nullopt;
+        };
+        const auto from_ovf = [](ovf r) -> std::optional<bool> { // true means "no overflow".
+            if (r == ovf::NeverOverflows)
+                return true;
+            if (r == ovf::MayOverflow)
+                return std::nullopt;
+            return false;
+        };
+
+        switch (e.decl().decl_kind()) {
+        case Z3_OP_TRUE:
+            return true;
+        case Z3_OP_FALSE:
+            return false;
+        case Z3_OP_NOT:
+            return not_(eval_bool(q, e.arg(0)));
+        case Z3_OP_AND:
+        case Z3_OP_OR: {
+            const bool is_and = e.decl().decl_kind() == Z3_OP_AND;
+            bool all_decided = true;
+            for (unsigned i = 0; i < e.num_args(); ++i) {
+                const auto v = eval_bool(q, e.arg(i));
+                if (!v.has_value())
+                    all_decided = false;
+                else if (v.value() != is_and)
+                    return !is_and;
+            }
+            if (all_decided)
+                return is_and;
+            return std::nullopt;
+        }
+        case Z3_OP_IMPLIES: {
+            const auto l = eval_bool(q, e.arg(0));
+            if (l == false)
+                return true;
+            const auto r = eval_bool(q, e.arg(1));
+            if (r == true)
+                return true;
+            if (l == true)
+                return r;
+            return std::nullopt;
+        }
+        case Z3_OP_ITE: {
+            const auto c = eval_bool(q, e.arg(0));
+            if (c.has_value())
+                return eval_bool(q, e.arg(c.value() ? 1 : 2));
+            const auto t = eval_bool(q, e.arg(1)), f = eval_bool(q, e.arg(2));
+            return t == f ? t : std::nullopt;
+        }
+        case Z3_OP_EQ:
+        case Z3_OP_DISTINCT: {
+            if (e.num_args() != 2)
+                return std::nullopt;
+
+            std::optional<bool> eq = std::nullopt;
+            if (e.arg(0).is_bool()) {
+                const auto l = eval_bool(q, e.arg(0)), r = eval_bool(q, e.arg(1));
+                if (l.has_value() && r.has_value())
+                    eq = l.value() == r.value();
+            } else if (e.arg(0).is_bv()) {
+                const auto l = eval_bv(q, e.arg(0)), r = eval_bv(q, e.arg(1));
+                if (l.intersectWith(r).isEmptySet())
+                    eq = false;
+                else if (l.isSingleElement() && r.isSingleElement())
+                    eq = true; // both are the same single element.
+            }
+            return e.decl().decl_kind() == Z3_OP_EQ ? eq : not_(eq);
+        }
+        case Z3_OP_ULEQ:
+            return cmp(q, e, CmpInst::ICMP_ULE);
+        case Z3_OP_ULT:
+            return cmp(q, e, CmpInst::ICMP_ULT);
+        case Z3_OP_UGEQ:
+            return cmp(q, e, CmpInst::ICMP_UGE);
+        case Z3_OP_UGT:
+            return cmp(q, e, CmpInst::ICMP_UGT);
+        case Z3_OP_SLEQ:
+            return cmp(q, e, CmpInst::ICMP_SLE);
+        case Z3_OP_SLT:
+            return cmp(q, e, CmpInst::ICMP_SLT);
+        case Z3_OP_SGEQ:
+            return cmp(q, e, CmpInst::ICMP_SGE);
+        case Z3_OP_SGT:
+            return cmp(q, e, CmpInst::ICMP_SGT);
+        case Z3_OP_BUMUL_NO_OVFL:
+            return from_ovf(eval_bv(q, e.arg(0)).unsignedMulMayOverflow(eval_bv(q, e.arg(1))));
+        default:
+            return std::nullopt;
+        }
+    }
+
+    std::optional<bool> cmp(query& q, const z3::expr& e, CmpInst::Predicate pred)
+    {
+        const auto l = eval_bv(q, e.arg(0)), r = eval_bv(q, e.arg(1));
+        if (l.isEmptySet() || r.isEmptySet())
+            return std::nullopt;
+        if (l.icmp(pred, r))
+            return true;
+        if (l.icmp(CmpInst::getInversePredicate(pred), r))
+            return false;
+        return std::nullopt;
+    }
+
+    ConstantRange eval_bv(query& q, const z3::expr& e)
+    {
+        if (auto it = q.bv_memo.find(e.id()); it != q.bv_memo.end())
+            return it->second;
+
+        auto ret = eval_bv_impl(q, e);
+        q.bv_memo.emplace(e.id(), ret);
+        return ret;
+    }
+
+    ConstantRange eval_bv_impl(query& q, const z3::expr& e)
+    {
+        if (e.is_numeral())
+            return ConstantRange(mkint::numeral_of(e));
+
+        if (!e.is_app())
+            return full(e);
+
+        const auto fold = [&](auto op) {
+            auto ret = eval_bv(q, e.arg(0));
+            for (unsigned i = 1; i < e.num_args(); ++i)
+                ret = op(ret, eval_bv(q, e.arg(i)));
+            return ret;
+        };
+
+        switch (e.decl().decl_kind()) {
+        case Z3_OP_UNINTERPRETED:
+            if (e.is_const())
+                if (auto it = q.bounds.find(e.id()); it != q.bounds.end())
+                    return it->second;
+            return full(e);
+        case Z3_OP_BADD:
+            return fold([](const ConstantRange& l, const ConstantRange& r) { return l.add(r); });
+        case Z3_OP_BSUB:
+            return fold([](const ConstantRange& l, const ConstantRange& r) { return l.sub(r); });
+        case Z3_OP_BMUL:
+            return fold([](const ConstantRange& l, const ConstantRange& r) { return l.multiply(r); });
+        case Z3_OP_BAND:
+            return fold([](const ConstantRange& l, const ConstantRange& r) { return l.binaryAnd(r); });
+        case Z3_OP_BOR:
+            return fold([](const ConstantRange& l, const ConstantRange& r) { return l.binaryOr(r); });
+        case Z3_OP_BXOR:
+            return fold([](const ConstantRange& l, const ConstantRange& r) { return l.binaryXor(r); });
+        case Z3_OP_BNEG:
+            return ConstantRange(APInt::getZero(bits(e))).sub(eval_bv(q, e.arg(0)));
+        case Z3_OP_BNOT:
+            return eval_bv(q, e.arg(0)).binaryNot();
+        case Z3_OP_BUDIV:
+        case Z3_OP_BUDIV_I:
+            return eval_bv(q, e.arg(0)).udiv(eval_bv(q, e.arg(1)));
+        case Z3_OP_BUREM:
+        case Z3_OP_BUREM_I:
+            return eval_bv(q, e.arg(0)).urem(eval_bv(q, e.arg(1)));
+        case Z3_OP_BSDIV:
+        case Z3_OP_BSDIV_I:
+            return eval_bv(q, e.arg(0)).sdiv(eval_bv(q, e.arg(1)));
+        case Z3_OP_BSREM:
+        case Z3_OP_BSREM_I:
+            return eval_bv(q, e.arg(0)).srem(eval_bv(q, e.arg(1)));
+        case Z3_OP_BSHL:
+            return eval_bv(q, e.arg(0)).shl(eval_bv(q, e.arg(1)));
+        case Z3_OP_BLSHR:
+            return eval_bv(q, e.arg(0)).lshr(eval_bv(q, e.arg(1)));
+        case Z3_OP_BASHR:
+            return eval_bv(q, e.arg(0)).ashr(eval_bv(q, e.arg(1)));
+        case Z3_OP_ZERO_EXT:
+            return eval_bv(q, e.arg(0)).zeroExtend(bits(e));
+        case Z3_OP_SIGN_EXT:
+            return eval_bv(q, e.arg(0)).signExtend(bits(e));
+        case Z3_OP_EXTRACT: {
+            const auto src = eval_bv(q, e.arg(0));
+            return src.lshr(ConstantRange(APInt(src.getBitWidth(), e.lo()))).truncate(bits(e));
+        }
+        case Z3_OP_CONCAT: {
+            auto ret = eval_bv(q, e.arg(0)).zeroExtend(bits(e));
+            for (unsigned i = 1; i < e.num_args(); ++i) {
+                const auto part = eval_bv(q, e.arg(i));
+                ret = ret.shl(ConstantRange(APInt(bits(e), part.getBitWidth())))
+                          .binaryOr(part.zeroExtend(bits(e)));
+            }
+            return ret;
+        }
+        case Z3_OP_ITE: {
+            const auto c = eval_bool(q, e.arg(0));
+            if (c.has_value())
+                return eval_bv(q, e.arg(c.value() ? 1 : 2));
+            return eval_bv(q, e.arg(1)).unionWith(eval_bv(q, e.arg(2)));
+        }
+        default:
+            return full(e);
+        }
+    }
+
+    std::vector<z3::expr> m_facts; // unguarded assertions.
+    std::unordered_map<unsigned, std::vector<z3::expr>> m_guarded; // literal -> assertions guarded by it.
+    std::vector<z3::expr> m_lits; // keeps the keys of `m_guarded` alive: ids of dead ASTs are reused.
+    std::unique_ptr<smt_backend> m_fallback;
+    size_t m_n_queries = 0;
+    size_t m_n_resolved = 0;
+}; // class interval_backend
+
+// Assertions of a backend, split into unguarded facts and the ones guarded by an assumption literal (`lit => e`).
+struct guarded_store {
+    static bool is_lit(const z3::expr& e)
+    {
+        return e.is_const() && e.is_bool() && e.decl().decl_kind() == Z3_OP_UNINTERPRETED;
+    }
+
+    void add(const z3::expr& e)
+    {
+        if (e.is_app() && e.decl().decl_kind() == Z3_OP_IMPLIES && is_lit(e.arg(0))) {
+            auto& facts = guarded[e.arg(0).id()];
+            if (facts.empty())
+                lits.push_back(e.arg(0));
+            facts.push_back(e.arg(1));
+        } else {
+            facts.push_back(e);
+        }
+    }
+
+    void retire(const z3::expr& lit) { guarded.erase(lit.id()); } // `lit` stays in `lits`.
+
+    void clear()
+    {
+        facts.clear();
+        guarded.clear();
+        lits.clear();
+    }
+
+    // A standalone query equivalent to checking all assertions under `assumptions`: assumed literals are replaced by
+    // their facts; other literals referenced by them keep their guards. Constants and uninterpreted functions of the
+    // query go to `consts` (possibly repeated).
+    z3::expr_vector resolve(const z3::expr_vector& assumptions, std::vector<z3::func_decl>* consts = nullptr) const
+    {
+        z3::expr_vector query(assumptions.ctx());
+        std::unordered_set<unsigned> assumed, visited;
+        std::vector<z3::expr> worklist;
+        for (const auto& f : facts) {
+            query.push_back(f);
+            worklist.push_back(f);
+        }
+        for (const auto& a : assumptions) {
+            assumed.insert(a.id());
+            if (auto it = guarded.find(a.id()); it != guarded.end()) {
+                for (const auto& f : it->second) {
+                    query.push_back(f);
+                    worklist.push_back(f);
+                }
+            } else {
+                query.push_back(a);
+                worklist.push_back(a);
+            }
+        }
+
+        while (!worklist.empty()) {
+            const auto e = worklist.back();
+            worklist.pop_back();
+            if (!visited.insert(e.id()).second)
+                continue;
+
+            if (e.is_const() && e.decl().decl_kind() == Z3_OP_UNINTERPRETED) {
+                if (consts)
+                    consts->push_back(e.decl());
+                if (!is_lit(e) || assumed.count(e.id()))
+                    continue;
+                if (auto it = guarded.find(e.id()); it != guarded.end()) {
+                    for (const auto& f : it->second) {
+                        query.push_back(z3::implies(e, f));
+                        worklist.push_back(f);
+                    }
+                }
+            } else if (e.is_app()) {
+                if (consts && e.decl().decl_kind() == Z3_OP_UNINTERPRETED)
+                    consts->push_back(e.decl());
+                for (unsigned i = 0; i < e.num_args(); ++i)
+                    worklist.push_back(e.arg(i));
+            }
+        }
+        return query;
+    }
+
+    std::vector<z3::expr> facts; // unguarded assertions.
+    std::unordered_map<unsigned, std::vector<z3::expr>> guarded; // literal -> assertions guarded by it.
+    std::vector<z3::expr> lits; // keeps the keys of `guarded` alive: ids of dead ASTs are reused.
+}; // struct guarded_store
+
+std::string to_smt2(z3::context& ctx, const z3::expr_vector& query)
+{
+    z3::solver s(ctx);
+    for (const auto& e : query)
+        s.add(e);
+    return s.to_smt2();
+}
+
+// Solves queries in a pool of worker processes (see `mkint::solver_pool`); the assertions are kept here and every
+// query is shipped as a standalone SMT-LIB2 formula.
+class process_backend final : public smt_backend {
+public:
+    process_backend(std::shared_ptr<smt_session> session, std::shared_ptr<mkint::solver_pool> pool)
+        : smt_backend(std::move(session))
+        , m_pool(std::move(pool))
+    {
+    }
+
+    const char* name() const override { return "z3-workers"; }
+    void add(const z3::expr& e) override { m_store.add(e); }
+    void retire(const z3::expr& lit) override { m_store.retire(lit); }
+
+    z3::check_result check(const z3::expr_vector& assumptions) override
+    {
+        std::vector<z3::func_decl> consts;
+        const auto query = m_store.resolve(assumptions, &consts);
+        const auto reply = m_pool->solve(to_smt2(ctx(), query), m_timeout);
+
+        m_model.reset();
+        if (reply.verdict == z3::sat) {
+            // declarations are matched by name and width; assumption literals have integer symbols, which are
+            // renamed in SMT-LIB2, but they are never evaluated.
+            std::map<std::pair<std::string, unsigned>, z3::func_decl> decls;
+            for (const auto& d : consts) {
+                if (Z3_get_symbol_kind(ctx(), d.name()) == Z3_STRING_SYMBOL)
+                    decls.try_emplace({ d.name().str(), d.range().is_bv() ? d.range().bv_size() : 0 }, d);
+            }
+
+            const auto val = [this](const std::string& v, const z3::sort& s) {
+                return s.is_bv() ? ctx().bv_val(v.c_str(), s.bv_size()) : ctx().bool_val(v == "true");
+            };
+
+            z3::model m(ctx());
+            std::map<unsigned, z3::func_interp> funcs;
+            for (const auto& [name, bits, value, args] : reply.model) {
+                auto it = decls.find({ name, bits });
+                if (it == decls.end() || it->second.arity() != args.size())
+                    continue;
+
+                auto& d = it->second;
+                z3::expr v = val(value, d.range());
+                if (args.empty()) {
+                    m.add_const_interp(d, v);
+                    continue;
+                }
+
+                // only the applications of the query are known; other arguments are mapped to 0.
+                auto fi = funcs.find(d.id());
+                if (fi == funcs.end()) {
+                    z3::expr otherwise = val("0", d.range());
+                    fi = funcs.try_emplace(d.id(), m.add_func_interp(d, otherwise)).first;
+                }
+                z3::expr_vector entry(ctx());
+                for (unsigned i = 0; i < args.size(); ++i)
+                    entry.push_back(val(args[i], d.domain(i)));
+                fi->second.add_entry(entry, v);
+            }
+            m_model.emplace(m);
+        }
+        return reply.verdict;
+    }
+
+    z3::model get_model() override
+    {
+        MKINT_CHECK_ABORT(m_model.has_value()) << "no model: the last query was not sat";
+        return m_model.value();
+    }
+
+    void set_timeout(unsigned timeout) override { m_timeout = timeout; }
+
+    void reset() override
+    {
+        m_store.clear();
+        m_model.reset();
+    }
+
+    std::string stats() const override
+    {
+        return std::to_string(m_pool->size()) + " workers, " + std::to_string(m_pool->n_restarts()) + " restarts";
+    }
+
+private:
+    std::shared_ptr<mkint::solver_pool> m_pool;
+    guarded_store m_store;
+    std::optional<z3::model> m_model;
+    unsigned m_timeout = 0;
+}; // class process_backend
+
+// Z3 with a portfolio of strategies: a query is first given `after` ms in-process (0 skips this); if that is not
+// enough, it is translated to a fresh context per strategy and the strategies race in parallel threads. The first
+// definite answer wins and the other strategies are interrupted.
+class portfolio_backend final : public smt_backend {
+public:
+    portfolio_backend(std::shared_ptr<smt_session> session, std::vector<std::string> strategies, unsigned after,
+        unsigned rlimit)
+        : smt_backend(std::move(session))
+        , m_after(after)
+        , m_rlimit(rlimit)
+    {
+        z3::context scratch;
+        for (auto& s : strategies) {
+            if (s != "default" && !make_solver(scratch, s)) {
+                MKINT_WARN() << "Ignoring unknown SMT portfolio strategy: " << s;
+                continue;
+            }
+            m_strategies.push_back(std::move(s));
+        }
+        MKINT_CHECK_ABORT(!m_strategies.empty()) << "No valid SMT portfolio strategy";
+    }
+
+    const char* name() const override { return "z3-portfolio"; }
+
+    void add(const z3::expr& e) override
+    {
+        m_store.add(e);
+        m_session->solver().add(e);
+    }
+
+    void retire(const z3::expr& lit) override
+    {
+        m_store.retire(lit);
+        m_session->solver().add(!lit);
+    }
+
+    z3::check_result check(const z3::expr_vector& assumptions) override
+    {
+        m_model.reset();
+        if (m_after) {
+            m_session->set_timeout(m_timeout ? std::min(m_timeout, m_after) : m_after);
+            const auto res = m_session->solver().check(assumptions);
+            if (res != z3::unknown || (m_timeout && m_timeout <= m_after)) {
+                ++m_wins[res == z3::unknown ? "unknown" : "first try"];
+                return res;
+            }
+        }
+        return race(m_store.resolve(assumptions), m_timeout ? m_timeout - m_after : 0);
+    }
+
+    z3::model get_model() override
+    {
+        return m_model.has_value() ? m_model.value() : m_session->solver().get_model();
+    }
+
+    void set_timeout(unsigned timeout) override { m_timeout = timeout; }
+
+    void reset() override
+    {
+        m_store.clear();
+        m_model.reset();
+        smt_backend::reset();
+    }
+
+    std::string stats() const override
+    {
+        std::string out = "wins:";
+        for (const auto& [strategy, n] : m_wins)
+            out += " " + strategy + "=" + std::to_string(n);
+        return out;
+    }
+
+private:
+    // `default`, or tactics applied in sequence, e.g. `simplify+solve-eqs+bit-blast+sat`; nullopt if a tactic does
+    // not exist.
+    static std::optional<z3::solver> make_solver(z3::context& ctx, const std::string& strategy)
+    {
+        if (strategy == "default")
+            return z3::solver(ctx);
+
+        // an unknown tactic name cannot be caught after the fact without exceptions.
+        std::unordered_set<std::string> known;
+        for (unsigned i = 0; i < Z3_get_num_tactics(ctx); ++i)
+            known.insert(Z3_get_tactic_name(ctx, i));
+
+        std::optional<z3::tactic> tactic;
+        for (StringRef rest = strategy; !rest.empty();) {
+            StringRef name;
+            std::tie(name, rest) = rest.split('+');
+            if (!known.count(name.str()))
+                return std::nullopt;
+            z3::tactic t(ctx, name.str().c_str());
+            tactic = tactic.has_value() ? tactic.value() & t : t;
+        }
+        if (!tactic.has_value())
+            return std::nullopt;
+        return tactic->mk_solver();
+    }
+
+    z3::check_result race(const z3::expr_vector& query, unsigned timeout)
+    {
+        struct racer {
+            std::unique_ptr<z3::context> ctx = std::make_unique<z3::context>();
+            z3::check_result res = z3::unknown;
+            std::optional<z3::model> model;
+            bool done = false;
+        };
+
+        // contexts are not thread-safe: everything a racer touches is translated before it starts.
+        std::vector<racer> racers(m_strategies.size());
+        std::vector<z3::expr_vector> queries;
+        for (auto& r : racers)
+            queries.emplace_back(*r.ctx, query);
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::optional<size_t> winner;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < racers.size(); ++i) {
+            threads.emplace_back([&, i] {
+                auto& r = racers[i];
+                auto solver = make_solver(*r.ctx, m_strategies[i]);
+                z3::params p(*r.ctx);
+                p.set("timeout", timeout ? timeout : std::numeric_limits<unsigned>::max());
+                if (m_rlimit)
+                    p.set("rlimit", m_rlimit);
+                solver->set(p);
+                solver->add(queries[i]);
+
+                const auto res = solver->check();
+                std::optional<z3::model> model;
+                if (res == z3::sat)
+                    model.emplace(solver->get_model());
+
+                std::lock_guard<std::mutex> lock(mutex);
+                r.res = res;
+                r.model = std::move(model);
+                r.done = true;
+                if (res != z3::unknown && !winner.has_value())
+                    winner = i;
+                cv.notify_all();
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            const auto all_done = [&racers] {
+                return std::all_of(racers.begin(), racers.end(), [](const racer& r) { return r.done; });
+            };
+            cv.wait(lock, [&] { return winner.has_value() || all_done(); });
+            // an interrupt is lost if it comes before the solver starts: repeat it until everyone stopped.
+            while (!all_done()) {
+                for (auto& r : racers) {
+                    if (!r.done)
+                        r.ctx->interrupt();
+                }
+                cv.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        }
+        for (auto& t : threads)
+            t.join();
+
+        if (!winner.has_value()) {
+            ++m_wins["unknown"];
+            return z3::unknown;
+        }
+
+        auto& r = racers[winner.value()];
+        ++m_wins[m_strategies[winner.value()]];
+        if (r.res == z3::sat)
+            m_model.emplace(r.model.value(), ctx(), z3::model::translate {});
+        return r.res;
+    }
+
+    std::vector<std::string> m_strategies;
+    unsigned m_after;
+    unsigned m_rlimit;
+    unsigned m_timeout = 0;
+    guarded_store m_store;
+    std::optional<z3::model> m_model; // of the winning racer, translated back.
+    std::map<std::string, size_t> m_wins;
+}; // class portfolio_backend
+
+// Writes every query as a standalone SMT-LIB2 file (assumed guards are resolved) before forwarding it.
+class dump_backend final : public smt_backend {
+public:
+    dump_backend(std::shared_ptr<smt_session> session, std::unique_ptr<smt_backend> inner, std::string dir)
+        : smt_backend(std::move(session))
+        , m_inner(std::move(inner))
+        , m_dir(std::move(dir))
+    {
+        if (auto ec = sys::fs::create_directories(m_dir))
+            MKINT_WARN() << "Cannot create SMT dump directory " << m_dir << ": " << ec.message();
+    }
+
+    const char* name() const override { return m_inner->name(); }
+
+    void add(const z3::expr& e) override
+    {
+        m_store.add(e);
+        m_inner->add(e);
+    }
+
+    void retire(const z3::expr& lit) override
+    {
+        m_store.retire(lit);
+        m_inner->retire(lit);
+    }
+
+    z3::check_result check(const z3::expr_vector& assumptions) override
+    {
+        m_inner->set_tag(m_tag);
+        const auto begin = std::chrono::steady_clock::now();
+        const auto res = m_inner->check(assumptions);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+        dump(assumptions, res, elapsed.count());
+        return res;
+    }
+
+    z3::model get_model() override { return m_inner->get_model(); }
+    void set_timeout(unsigned timeout) override { m_inner->set_timeout(timeout); }
+
+    void reset() override
+    {
+        m_store.clear();
+        m_inner->reset();
+    }
+
+    std::string stats() const override { return m_inner->stats(); }
+
+private:
+    void dump(const z3::expr_vector& assumptions, z3::check_result res, double ms)
+    {
+        std::string func = "none", inst = "none";
+        if (m_tag.inst) {
+            func = m_tag.inst->getFunction()->getName().str();
+            inst.clear();
+            raw_string_ostream(inst) << *m_tag.inst;
+        }
+
+        std::string kind(m_tag.kind.empty() ? "query" : m_tag.kind);
+        std::replace(kind.begin(), kind.end(), ' ', '-');
+
+        char seq[16];
+        std::snprintf(seq, sizeof(seq), "%06zu", m_n_dumped++);
+        SmallString<128> path(m_dir);
+        sys::path::append(path, std::string(seq) + "-" + func + "-" + kind + ".smt2");
+
+        std::error_code ec;
+        raw_fd_ostream os(path, ec);
+        if (ec) {
+            MKINT_WARN() << "Cannot write SMT dump " << path.str().str() << ": " << ec.message();
+            return;
+        }
+
+        os << "; function: " << func << '\n';
+        os << "; instruction: " << StringRef(inst).trim() << '\n';
+        os << "; kind: " << kind << '\n';
+        os << "; verdict: " << (res == z3::sat ? "sat" : res == z3::unsat ? "unsat" : "unknown") << '\n';
+        os << "; time-ms: " << format("%.3f", ms) << '\n';
+        os << to_smt2(ctx(), m_store.resolve(assumptions));
+    }
+
+    std::unique_ptr<smt_backend> m_inner;
+    std::string m_dir;
+    guarded_store m_store;
+    size_t m_n_dumped = 0;
+}; // class dump_backend
+
+} // namespace
+
+namespace {
+
+// One task in the (fresh) solver of a worker thread; mirrors the batched block checks of the pass.
+mkint::check_outcome solve_task(z3::context& ctx, const z3::expr_vector& facts, const z3::expr_vector& goals,
+    const std::vector<z3::expr_vector>& terms, const mkint::parallel_config& config)
+{
+    mkint::check_outcome out;
+    out.started = true;
+    out.verdicts.assign(goals.size(), z3::unknown);
+    out.values.resize(goals.size());
+
+    z3::solver solver(ctx);
+    if (config.rlimit) {
+        z3::params p(ctx);
+        p.set("rlimit", config.rlimit);
+        solver.set(p);
+    }
+    for (const auto& f : facts)
+        solver.add(f);
+
+    unsigned n_lits = 0;
+    const auto guard = [&](const z3::expr& e) {
+        const auto lit = ctx.constant(ctx.int_symbol(n_lits++), ctx.bool_sort());
+        solver.add(z3::implies(lit, e));
+        return lit;
+    };
+    const auto check = [&](const z3::expr& lit) {
+        unsigned timeout = config.timeout;
+        if (config.deadline.has_value()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= config.deadline.value())
+                return z3::unknown;
+            const auto left
+                = std::chrono::duration_cast<std::chrono::milliseconds>(config.deadline.value() - now).count() + 1;
+            timeout = timeout ? std::min<unsigned>(timeout, left) : left;
+        }
+        z3::params p(ctx);
+        p.set("timeout", timeout ? timeout : std::numeric_limits<unsigned>::max());
+        solver.set(p);
+
+        z3::expr_vector assumptions(ctx);
+        assumptions.push_back(lit);
+        return solver.check(assumptions);
+    };
+    const auto record = [&](size_t i, const z3::model& m) {
+        out.verdicts[i] = z3::sat;
+        for (const auto& t : terms[i])
+            out.values[i].push_back(mkint::numeral_of(m.eval(t, true)));
+    };
+
+    std::vector<z3::expr> lits;
+    for (const auto& g : goals)
+        lits.push_back(guard(g));
+
+    std::vector<size_t> pending(goals.size());
+    std::iota(pending.begin(), pending.end(), 0);
+    while (config.batch && pending.size() > 1) {
+        z3::expr_vector any(ctx);
+        for (auto i : pending)
+            any.push_back(lits[i]);
+
+        const auto res = check(guard(z3::mk_or(any)));
+        if (res == z3::unsat) { // all remaining goals are unsatisfiable.
+            for (auto i : pending)
+                out.verdicts[i] = z3::unsat;
+            return out;
+        }
+        if (res == z3::unknown)
+            break;
+
+        const auto m = solver.get_model();
+        std::vector<size_t> left;
+        for (auto i : pending) {
+            if (m.eval(goals[i], true).is_true())
+                record(i, m);
+            else
+                left.push_back(i);
+        }
+        if (left.size() == pending.size())
+            break;
+        pending = std::move(left);
+    }
+
+    for (auto i : pending) {
+        const auto res = check(lits[i]);
+        if (res == z3::sat)
+            record(i, solver.get_model());
+        else
+            out.verdicts[i] = res;
+    }
+    return out;
+}
+
+} // namespace
+
+std::vector<mkint::check_outcome> mkint::solve_in_parallel(
+    const std::vector<check_task>& tasks, const parallel_config& config)
+{
+    std::vector<check_outcome> outcomes(tasks.size());
+    const size_t n_threads = std::max<size_t>(1, std::min<size_t>(config.threads, tasks.size()));
+
+    std::vector<std::deque<size_t>> queues(n_threads);
+    std::vector<std::mutex> queue_locks(n_threads);
+    for (size_t i = 0; i < tasks.size(); ++i)
+        queues[i % n_threads].push_back(i);
+
+    // the source context is not thread-safe: translations out of it are serialized.
+    std::mutex source_lock;
+    const auto take = [&](size_t self) -> std::optional<size_t> {
+        for (size_t k = 0; k < n_threads; ++k) {
+            const size_t victim = (self + k) % n_threads;
+            std::lock_guard<std::mutex> lock(queue_locks[victim]);
+            auto& q = queues[victim];
+            if (q.empty())
+                continue;
+            size_t task;
+            if (victim == self) {
+                task = q.front();
+                q.pop_front();
+            } else {
+                task = q.back();
+                q.pop_back();
+            }
+            return task;
+        }
+        return std::nullopt;
+    };
+
+    const auto work = [&](size_t self) {
+        z3::context ctx;
+        while (auto next = take(self)) {
+            const auto& task = tasks[next.value()];
+            auto task_config = config;
+            if (task.deadline.has_value() && (!config.deadline.has_value() || task.deadline < config.deadline))
+                task_config.deadline = task.deadline;
+            if (task_config.deadline.has_value() && std::chrono::steady_clock::now() >= task_config.deadline.value())
+                continue; // left unstarted.
+
+            if (task.goals.empty())
+                continue;
+            std::optional<z3::expr_vector> facts, goals;
+            std::vector<z3::expr_vector> terms;
+            {
+                std::lock_guard<std::mutex> lock(source_lock);
+                z3::context& src = task.goals.front().ctx();
+                z3::expr_vector src_facts(src), src_goals(src);
+                for (const auto& f : task.facts)
+                    src_facts.push_back(f);
+                for (const auto& g : task.goals)
+                    src_goals.push_back(g);
+                facts.emplace(ctx, src_facts);
+                goals.emplace(ctx, src_goals);
+                for (const auto& ts : task.terms) {
+                    z3::expr_vector src_terms(src);
+                    for (const auto& t : ts)
+                        src_terms.push_back(t);
+                    terms.emplace_back(ctx, src_terms);
+                }
+            }
+            outcomes[next.value()] = solve_task(ctx, facts.value(), goals.value(), terms, task_config);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n_threads; ++i)
+        threads.emplace_back(work, i);
+    work(0);
+    for (auto& t : threads)
+        t.join();
+    return outcomes;
+}
+
+std::unique_ptr<mkint::smt_backend> mkint::make_smt_backend(const smt_config& config)
+{
+    auto session = std::make_shared<smt_session>(config.rlimit);
+    const auto make_z3 = [&]() -> std::unique_ptr<smt_backend> {
+        if (config.workers) {
+            // shared by all backends of this process, so workers are forked once.
+            static std::weak_ptr<solver_pool> s_pool;
+            auto pool = s_pool.lock();
+            if (!pool || pool->size() != config.workers) {
+                pool = std::make_shared<solver_pool>(config.workers, config.worker_mem, config.rlimit);
+                s_pool = pool;
+            }
+            return std::make_unique<process_backend>(session, pool);
+        }
+        if (!config.portfolio.empty())
+            return std::make_unique<portfolio_backend>(session, config.portfolio, config.portfolio_after, config.rlimit);
+        return std::make_unique<z3_backend>(session);
+    };
+
+    std::unique_ptr<smt_backend> backend;
+    switch (config.kind) {
+    case smt_backend_kind::INTERVAL:
+        backend = std::make_unique<interval_backend>(session, nullptr);
+        break;
+    case smt_backend_kind::HYBRID:
+        backend = std::make_unique<interval_backend>(session, make_z3());
+        break;
+    default:
+        backend = make_z3();
+        break;
+    }
+
+    if (!config.dump_dir.empty())
+        backend = std::make_unique<dump_backend>(session, std::move(backend), config.dump_dir);
+    return backend;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <llvm/ADT/APInt.h>
+
+#include <z3++.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace llvm {
+class Instruction;
+}
+
+namespace mkint {
+
+// Owns a Z3 context and the solver built on top of it. A session is reused across modules: `reset()` drops all
+// assertions but keeps the context, and `release()` frees the context (a new one is created on the next access).
+// All expressions built from the session must be destroyed before `release()`.
+class smt_session {
+public:
+    explicit smt_session(unsigned rlimit = 0);
+    smt_session(smt_session&&) = default;
+    smt_session& operator=(smt_session&&) = default;
+    ~smt_session();
+
+    z3::context& ctx();
+    z3::solver& solver();
+
+    // per-query timeout in ms; 0 means no limit.
+    void set_timeout(unsigned timeout);
+
+    void reset();
+    void release();
+
+private:
+    void configure();
+
+    unsigned m_rlimit;
+    std::optional<unsigned> m_timeout; // the timeout currently applied to the solver.
+    std::unique_ptr<z3::context> m_ctx;
+    std::unique_ptr<z3::solver> m_solver;
+}; // class smt_session
+
+enum class smt_backend_kind {
+    Z3, // everything goes to Z3.
+    INTERVAL, // in-tree interval reasoning only; undecided queries are unknown.
+    HYBRID, // interval reasoning first; undecided queries are forwarded to Z3.
+};
+
+// what a query checks; only used for diagnostics such as query dumps.
+struct smt_query_tag {
+    const llvm::Instruction* inst = nullptr;
+    std::string_view kind = "";
+};
+
+// Terms are Z3 ASTs of the session's context: building them is cheap and does not involve any solving. Backends
+// differ in how asserted constraints are decided.
+class smt_backend {
+public:
+    explicit smt_backend(std::shared_ptr<smt_session> session);
+    virtual ~smt_backend() = default;
+
+    z3::context& ctx() { return m_session->ctx(); }
+    z3::expr bv_val(uint64_t v, unsigned bits) { return ctx().bv_val(v, bits); }
+    z3::expr bv_const(const char* name, unsigned bits) { return ctx().bv_const(name, bits); }
+    z3::expr bool_const(int id) { return ctx().constant(ctx().int_symbol(id), ctx().bool_sort()); }
+
+    virtual const char* name() const = 0;
+    virtual void add(const z3::expr& e) = 0;
+    // `lit` guards assertions (`lit => e`) and will never be assumed again: they can be dropped.
+    virtual void retire(const z3::expr& lit) { add(!lit); }
+    virtual z3::check_result check(const z3::expr_vector& assumptions) = 0;
+    // only valid right after a `check` returning sat.
+    virtual z3::model get_model() = 0;
+    // per-query timeout in ms; 0 means no limit.
+    virtual void set_timeout(unsigned timeout) { m_session->set_timeout(timeout); }
+    virtual void reset() { m_session->reset(); }
+    virtual std::string stats() const { return ""; }
+
+    void set_tag(const smt_query_tag& tag) { m_tag = tag; }
+
+protected:
+    std::shared_ptr<smt_session> m_session;
+    smt_query_tag m_tag;
+}; // class smt_backend
+
+// value of a bit-vector numeral.
+llvm::APInt numeral_of(const z3::expr& e);
+
+struct smt_config {
+    smt_backend_kind kind = smt_backend_kind::Z3;
+    unsigned rlimit = 0; // Z3 resource limit of a single query; 0 means no limit.
+    std::string dump_dir; // if not empty, every query is also written to it as a standalone SMT-LIB2 file.
+    unsigned workers = 0; // if not 0, Z3 queries are solved in this many worker processes.
+    unsigned worker_mem = 0; // address space (MiB) a worker may map beyond the host's; 0 means no limit.
+    // if not empty, in-process Z3 queries not answered within `portfolio_after` ms are raced by these strategies in
+    // parallel threads; a strategy is `default` (the default solver) or tactics joined by `+`.
+    std::vector<std::string> portfolio;
+    unsigned portfolio_after = 100;
+};
+
+std::unique_ptr<smt_backend> make_smt_backend(const smt_config& config);
+
+// Goals checked against the facts of one path; a satisfiable goal is a failed check.
+struct check_task {
+    std::vector<z3::expr> facts;
+    std::vector<z3::expr> goals;
+    std::vector<std::vector<z3::expr>> terms; // of each goal, evaluated in its model (e.g. the operands).
+    std::optional<std::chrono::steady_clock::time_point> deadline; // of this task, besides the one of the config.
+};
+
+struct check_outcome {
+    bool started = false; // false if the deadline passed before the task was picked up.
+    std::vector<z3::check_result> verdicts;
+    std::vector<std::vector<llvm::APInt>> values; // of the terms of each satisfied goal.
+};
+
+struct parallel_config {
+    unsigned threads = 1;
+    unsigned timeout = 0; // per query (ms); 0 means no limit.
+    unsigned rlimit = 0;
+    bool batch = true; // check all goals of a task with one query first.
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+};
+
+// Solves independent tasks on threads that each own a Z3 context; a task is translated into the context of the
+// thread running it. Tasks are dealt round-robin in order: a thread works through its own queue from the front and,
+// once it is empty, steals from the back of the others. The context of the tasks must stay untouched meanwhile.
+std::vector<check_outcome> solve_in_parallel(const std::vector<check_task>& tasks, const parallel_config& config);
+
+} // namespace mkint
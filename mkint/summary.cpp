@@ -0,0 +1,190 @@
+#include "summary.hpp"
+
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+
+using namespace llvm;
+
+namespace {
+
+// a range is `[bits, "lower", "upper"]`, with the bounds as unsigned decimals.
+json::Value range_to_json(const ConstantRange& rng)
+{
+    return json::Array { rng.getBitWidth(), toString(rng.getLower(), 10, false), toString(rng.getUpper(), 10, false) };
+}
+
+std::optional<ConstantRange> range_from_json(const json::Value* v)
+{
+    const json::Array* arr = v ? v->getAsArray() : nullptr;
+    if (!arr || arr->size() != 3)
+        return std::nullopt;
+
+    const auto bits = (*arr)[0].getAsInteger();
+    const auto lo = (*arr)[1].getAsString();
+    const auto hi = (*arr)[2].getAsString();
+    if (!bits || *bits <= 0 || !lo || !hi)
+        return std::nullopt;
+
+    APInt lower, upper;
+    if (lo->getAsInteger(10, lower) || hi->getAsInteger(10, upper))
+        return std::nullopt;
+    lower = lower.zextOrTrunc(*bits);
+    upper = upper.zextOrTrunc(*bits);
+    // `ConstantRange(lower, upper)` asserts that equal bounds are either extreme: they mean full or empty.
+    if (lower == upper)
+        return ConstantRange(*bits, lower.isMaxValue());
+    return ConstantRange(lower, upper);
+}
+
+std::optional<ConstantRange> join(const std::optional<ConstantRange>& a, const std::optional<ConstantRange>& b)
+{
+    if (!a || !b)
+        return a ? a : b;
+    if (a->getBitWidth() != b->getBitWidth()) // mismatching declarations: nothing is known.
+        return ConstantRange(a->getBitWidth(), true);
+    return a->unionWith(*b);
+}
+
+} // namespace
+
+mkint::summary_config& mkint::summary_options()
+{
+    static summary_config config;
+    return config;
+}
+
+bool mkint::write_summary(const module_summary& summary, const std::string& path, std::string& error)
+{
+    json::Object funcs;
+    for (const auto& [name, f] : summary.funcs) {
+        json::Array args;
+        for (const auto& a : f.args)
+            args.push_back(a ? range_to_json(*a) : json::Value(nullptr));
+
+        json::Object obj { { "defined", f.defined }, { "args", std::move(args) }, { "tainted", f.tainted },
+            { "sink", f.reaches_sink }, { "callees", json::Array(f.callees) } };
+        if (f.ret)
+            obj["ret"] = range_to_json(*f.ret);
+        funcs[name] = std::move(obj);
+    }
+
+    json::Object globals;
+    for (const auto& [name, rng] : summary.globals)
+        globals[name] = range_to_json(rng);
+
+    std::error_code ec;
+    raw_fd_ostream os(path, ec);
+    if (ec) {
+        error = ec.message();
+        return false;
+    }
+    os << json::Value(json::Object { { "functions", std::move(funcs) }, { "globals", std::move(globals) } }) << '\n';
+    return true;
+}
+
+bool mkint::read_summary(const std::string& path, module_summary& summary, std::string& error)
+{
+    auto buf = MemoryBuffer::getFile(path);
+    if (!buf) {
+        error = buf.getError().message();
+        return false;
+    }
+
+    auto parsed = json::parse((*buf)->getBuffer());
+    if (!parsed) {
+        error = toString(parsed.takeError());
+        return false;
+    }
+
+    const json::Object* root = parsed->getAsObject();
+    if (!root) {
+        error = "not a summary";
+        return false;
+    }
+
+    if (const auto funcs = root->getObject("functions")) {
+        for (const auto& [name, v] : *funcs) {
+            const json::Object* obj = v.getAsObject();
+            if (!obj)
+                continue;
+
+            function_summary f;
+            f.defined = obj->getBoolean("defined").getValueOr(false);
+            f.tainted = obj->getBoolean("tainted").getValueOr(false);
+            f.reaches_sink = obj->getBoolean("sink").getValueOr(false);
+            f.ret = range_from_json(obj->get("ret"));
+            if (const auto args = obj->getArray("args")) {
+                for (const auto& a : *args)
+                    f.args.push_back(range_from_json(&a));
+            }
+            if (const auto callees = obj->getArray("callees")) {
+                for (const auto& c : *callees) {
+                    if (auto s = c.getAsString())
+                        f.callees.push_back(s->str());
+                }
+            }
+            summary.funcs[name.str()] = std::move(f);
+        }
+    }
+
+    if (const auto globals = root->getObject("globals")) {
+        for (const auto& [name, v] : *globals) {
+            if (auto rng = range_from_json(&v))
+                summary.globals.insert_or_assign(name.str(), *rng);
+        }
+    }
+    return true;
+}
+
+mkint::module_summary mkint::merge_summaries(const std::vector<module_summary>& summaries)
+{
+    module_summary merged;
+    for (const auto& s : summaries) {
+        for (const auto& [name, f] : s.funcs) {
+            auto& m = merged.funcs[name];
+            m.defined |= f.defined;
+            m.tainted |= f.tainted;
+            m.reaches_sink |= f.reaches_sink;
+            if (f.defined)
+                m.ret = join(m.ret, f.ret);
+            if (m.args.size() < f.args.size())
+                m.args.resize(f.args.size());
+            for (size_t i = 0; i < f.args.size(); ++i)
+                m.args[i] = join(m.args[i], f.args[i]);
+            m.callees.insert(m.callees.end(), f.callees.begin(), f.callees.end());
+        }
+
+        for (const auto& [name, rng] : s.globals) {
+            auto it = merged.globals.find(name);
+            if (it == merged.globals.end())
+                merged.globals.insert({ name, rng });
+            else
+                it->second = *join(it->second, rng);
+        }
+    }
+
+    for (auto& [name, f] : merged.funcs) {
+        std::sort(f.callees.begin(), f.callees.end());
+        f.callees.erase(std::unique(f.callees.begin(), f.callees.end()), f.callees.end());
+    }
+
+    // a function reaches a sink if one of its callees, defined in any module, does.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto& [name, f] : merged.funcs) {
+            if (f.reaches_sink)
+                continue;
+            f.reaches_sink = std::any_of(f.callees.begin(), f.callees.end(), [&merged](const std::string& c) {
+                auto it = merged.funcs.find(c);
+                return it != merged.funcs.end() && it->second.reaches_sink;
+            });
+            changed |= f.reaches_sink;
+        }
+    }
+    return merged;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <llvm/IR/ConstantRange.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace mkint {
+
+// What the analysis of one module knows about an externally visible function. Definitions are summarized by their
+// own analysis; declarations by how this module calls them.
+struct function_summary {
+    bool defined = false;
+    std::optional<llvm::ConstantRange> ret; // of a definition with an integer return value.
+    std::vector<std::optional<llvm::ConstantRange>> args; // integer arguments: at the entry, or at the calls.
+    bool tainted = false; // a tainted definition, or a declaration called with tainted arguments.
+    bool reaches_sink = false; // only known for definitions.
+    std::vector<std::string> callees; // declarations called by a definition.
+};
+
+struct module_summary {
+    std::map<std::string, function_summary> funcs;
+    // of a defined global: its range; of a declared one: the values stored to it.
+    std::map<std::string, llvm::ConstantRange> globals;
+};
+
+// Where the pass reads the merged summary from and writes the summary of the analyzed module to (`-mkint-summary-*`).
+struct summary_config {
+    std::string in;
+    std::string out;
+    bool only = false; // stop after writing the summary: no solving, no reports.
+};
+
+summary_config& summary_options();
+
+bool write_summary(const module_summary& summary, const std::string& path, std::string& error);
+bool read_summary(const std::string& path, module_summary& summary, std::string& error);
+
+// One summary of the whole program: ranges and taint are joined over the modules, and the sink reachability of a
+// function is closed over the call edges of all modules. Taint only crosses one call edge per merge: it reaches the
+// callees of a tainted function through the next summary round. A function defined anywhere is `defined`.
+module_summary merge_summaries(const std::vector<module_summary>& summaries);
+
+} // namespace mkint
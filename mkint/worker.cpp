@@ -0,0 +1,407 @@
+#include "worker.hpp"
+#include "log.hpp"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+
+using namespace llvm;
+
+namespace {
+
+// frames are a native-endian 32-bit length followed by the payload.
+bool send_frame(int fd, const std::string& payload)
+{
+    const uint32_t len = payload.size();
+    std::string buf(reinterpret_cast<const char*>(&len), sizeof(len));
+    buf += payload;
+
+    for (size_t off = 0; off < buf.size();) {
+        const auto n = ::send(fd, buf.data() + off, buf.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        off += n;
+    }
+    return true;
+}
+
+// unframed, for the fork server.
+bool send_frame_raw(int fd, const std::string& payload)
+{
+    for (size_t off = 0; off < payload.size();) {
+        const auto n = ::send(fd, payload.data() + off, payload.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        off += n;
+    }
+    return true;
+}
+
+bool recv_all(int fd, char* buf, size_t len)
+{
+    for (size_t off = 0; off < len;) {
+        const auto n = ::recv(fd, buf + off, len - off, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        off += n;
+    }
+    return true;
+}
+
+bool recv_frame(int fd, std::string& payload)
+{
+    uint32_t len = 0;
+    if (!recv_all(fd, reinterpret_cast<char*>(&len), sizeof(len)))
+        return false;
+    payload.resize(len);
+    return recv_all(fd, payload.data(), len);
+}
+
+// wait until `fd` is readable (or closed); `timeout` < 0 waits forever.
+bool wait_readable(int fd, int timeout)
+{
+    pollfd p { fd, POLLIN, 0 };
+    while (true) {
+        const int n = ::poll(&p, 1, timeout);
+        if (n < 0 && errno == EINTR)
+            continue;
+        return n > 0;
+    }
+}
+
+std::string numeral(const z3::expr& v)
+{
+    if (v.is_bool())
+        return v.is_true() ? "true" : "false";
+    return v.is_numeral() ? Z3_get_numeral_string(v.ctx(), v) : "0";
+}
+
+unsigned width(const z3::sort& s) { return s.is_bv() ? s.bv_size() : 0; }
+
+// Model of a sat query: every constant, and every application of an uninterpreted function in the query.
+std::string serialize_model(const z3::solver& solver)
+{
+    const z3::model m = solver.get_model();
+    std::string out;
+    for (unsigned i = 0; i < m.num_consts(); ++i) {
+        const auto decl = m.get_const_decl(i);
+        out += decl.name().str() + '\t' + std::to_string(width(decl.range())) + '\t'
+            + numeral(m.get_const_interp(decl)) + '\n';
+    }
+
+    // function interpretations may be arbitrary terms; the applications are all the parent can evaluate anyway.
+    std::unordered_set<unsigned> visited;
+    std::vector<z3::expr> worklist;
+    for (const auto& e : solver.assertions())
+        worklist.push_back(e);
+    while (!worklist.empty()) {
+        const auto e = worklist.back();
+        worklist.pop_back();
+        if (!e.is_app() || !visited.insert(e.id()).second)
+            continue;
+
+        for (unsigned i = 0; i < e.num_args(); ++i)
+            worklist.push_back(e.arg(i));
+        if (e.num_args() == 0 || e.decl().decl_kind() != Z3_OP_UNINTERPRETED)
+            continue;
+
+        out += e.decl().name().str() + '\t' + std::to_string(width(e.get_sort())) + '\t' + numeral(m.eval(e, true))
+            + '\t';
+        for (unsigned i = 0; i < e.num_args(); ++i)
+            out += (i ? " " : "") + numeral(m.eval(e.arg(i), true));
+        out += '\n';
+    }
+    return out;
+}
+
+// Address space the process maps already. A worker is forked from the host, so LLVM, the module and the host's own
+// Z3 state are mapped in it too; its memory limit only bounds what the solver allocates on top of that.
+rlim_t mapped_bytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    unsigned long pages = 0;
+    statm >> pages;
+    return rlim_t(pages) * ::sysconf(_SC_PAGESIZE);
+}
+
+// request: "<timeout>\n<smt2>"; reply: "<verdict>\n" followed by the model for sat, one
+// "<name>\t<bits>\t<value>[\t<args>]\n" line per constant or function application.
+[[noreturn]] void worker_main(int fd, unsigned mem_limit, unsigned rlimit)
+{
+    // a crash is expected and handled by the parent: skip the crash handlers inherited from the host tool.
+    for (int sig : { SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGSEGV })
+        ::signal(sig, SIG_DFL);
+
+    if (mem_limit) {
+        const rlim_t bytes = mapped_bytes() + (rlim_t(mem_limit) << 20);
+        const struct rlimit lim { bytes, bytes };
+        setrlimit(RLIMIT_AS, &lim);
+    }
+
+    std::string req;
+    while (recv_frame(fd, req)) {
+        const auto nl = req.find('\n');
+        const unsigned timeout = std::strtoul(req.c_str(), nullptr, 10);
+
+        z3::context ctx;
+        // errors are checked below: in builds with C++ exceptions, a parse error would otherwise throw out of the
+        // worker and take it down.
+        ctx.set_enable_exceptions(false);
+        z3::solver solver(ctx);
+        z3::params p(ctx);
+        if (timeout)
+            p.set("timeout", timeout);
+        if (rlimit)
+            p.set("rlimit", rlimit);
+        solver.set(p);
+        solver.from_string(req.c_str() + nl + 1);
+
+        // a query that does not parse (e.g. ambiguous symbols) cannot be decided.
+        const auto res = Z3_get_error_code(ctx) == Z3_OK ? solver.check() : z3::unknown;
+        std::string reply = res == z3::sat ? "sat\n" : res == z3::unsat ? "unsat\n" : "unknown\n";
+        if (res == z3::sat)
+            reply += serialize_model(solver);
+
+        if (!send_frame(fd, reply))
+            break;
+    }
+    _exit(0);
+}
+
+// the pid of a worker, with the parent's end of its socket attached (if it was forked).
+bool send_worker(int chan, int32_t pid, int fd)
+{
+    iovec iov { &pid, sizeof(pid) };
+    msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    if (fd >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    }
+
+    while (true) {
+        const auto n = ::sendmsg(chan, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        return n == sizeof(pid);
+    }
+}
+
+bool recv_worker(int chan, int32_t& pid, int& fd)
+{
+    iovec iov { &pid, sizeof(pid) };
+    msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    fd = -1;
+    while (true) {
+        const auto n = ::recvmsg(chan, &msg, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n != sizeof(pid))
+            return false;
+        break;
+    }
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS)
+            std::memcpy(&fd, CMSG_DATA(c), sizeof(int));
+    }
+    return true;
+}
+
+// The fork server: forked once, while the host is still single-threaded, it forks the workers. A worker forked from
+// the host itself later on could inherit allocator or Z3 locks held by the host's other threads (portfolio, solver or
+// module loading threads) and deadlock.
+// requests: "s" forks a worker and replies with its pid and socket; "k<pid>" kills and reaps a worker.
+[[noreturn]] void server_main(int chan, unsigned mem_limit, unsigned rlimit)
+{
+    for (int sig : { SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGSEGV })
+        ::signal(sig, SIG_DFL);
+
+    char cmd;
+    while (recv_all(chan, &cmd, 1)) {
+        if (cmd == 'k') {
+            int32_t pid = -1;
+            if (!recv_all(chan, reinterpret_cast<char*>(&pid), sizeof(pid)))
+                break;
+            // workers are only reaped here, so `pid` cannot have been reused by another process yet.
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+            continue;
+        }
+
+        int sv[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+            send_worker(chan, -1, -1);
+            continue;
+        }
+
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(chan);
+            ::close(sv[0]);
+            worker_main(sv[1], mem_limit, rlimit);
+        }
+
+        ::close(sv[1]);
+        const bool sent = send_worker(chan, pid, pid < 0 ? -1 : sv[0]);
+        ::close(sv[0]);
+        if (!sent)
+            break;
+    }
+    _exit(0);
+}
+
+} // namespace
+
+mkint::solver_pool::solver_pool(unsigned n_workers, unsigned mem_limit, unsigned rlimit)
+    : m_workers(n_workers)
+{
+    int sv[2];
+    MKINT_CHECK_ABORT(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0)
+        << "Cannot create a socket for the SMT fork server: " << std::strerror(errno);
+
+    m_server_pid = ::fork();
+    MKINT_CHECK_ABORT(m_server_pid >= 0) << "Cannot fork the SMT fork server: " << std::strerror(errno);
+    if (m_server_pid == 0) {
+        ::close(sv[0]);
+        server_main(sv[1], mem_limit, rlimit);
+    }
+    ::close(sv[1]);
+    m_server_fd = sv[0];
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        if (spawn(m_workers[i]))
+            m_idle.push_back(i);
+    }
+    MKINT_CHECK_ABORT(!m_idle.empty()) << "Cannot start any SMT worker process";
+}
+
+mkint::solver_pool::~solver_pool()
+{
+    for (auto& w : m_workers)
+        stop(w);
+    // the server exits once its socket is closed.
+    ::close(m_server_fd);
+    ::waitpid(m_server_pid, nullptr, 0);
+}
+
+// must hold `m_mutex`: requests to the fork server must not interleave.
+bool mkint::solver_pool::spawn(worker& w)
+{
+    int32_t pid = -1;
+    int fd = -1;
+    if (!send_frame_raw(m_server_fd, "s") || !recv_worker(m_server_fd, pid, fd) || pid < 0 || fd < 0) {
+        MKINT_WARN() << "Cannot fork an SMT worker";
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+
+    w.pid = pid;
+    w.fd = fd;
+    return true;
+}
+
+// must hold `m_mutex` (or be the destructor).
+void mkint::solver_pool::stop(worker& w)
+{
+    if (w.fd >= 0)
+        ::close(w.fd);
+    if (w.pid > 0) {
+        std::string req = "k";
+        const int32_t pid = w.pid;
+        req.append(reinterpret_cast<const char*>(&pid), sizeof(pid));
+        send_frame_raw(m_server_fd, req);
+    }
+    w = worker {};
+}
+
+mkint::worker_reply mkint::solver_pool::solve(const std::string& smt2, unsigned timeout)
+{
+    size_t idx;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return !m_idle.empty(); });
+        idx = m_idle.back();
+        m_idle.pop_back();
+    }
+
+    // the worker enforces `timeout` itself; the grace period covers parsing and process overhead.
+    auto& w = m_workers[idx];
+    const int wait = timeout ? int(2 * timeout + 1000) : -1;
+    std::string payload;
+    const bool ok = w.fd >= 0 && send_frame(w.fd, std::to_string(timeout) + '\n' + smt2)
+        && wait_readable(w.fd, wait) && recv_frame(w.fd, payload);
+
+    worker_reply reply;
+    if (ok) {
+        const auto nl = payload.find('\n');
+        const auto verdict = payload.substr(0, nl);
+        reply.verdict = verdict == "sat" ? z3::sat : verdict == "unsat" ? z3::unsat : z3::unknown;
+        for (size_t pos = nl + 1; pos < payload.size();) {
+            const auto end = payload.find('\n', pos);
+            SmallVector<StringRef, 4> fields;
+            StringRef(payload).slice(pos, end).split(fields, '\t');
+            pos = end + 1;
+            if (fields.size() < 3)
+                continue;
+
+            worker_reply::assignment a { fields[0].str(), 0, fields[2].str(), {} };
+            fields[1].getAsInteger(10, a.bits);
+            if (fields.size() > 3) {
+                SmallVector<StringRef, 4> args;
+                fields[3].split(args, ' ');
+                for (auto arg : args)
+                    a.args.push_back(arg.str());
+            }
+            reply.model.push_back(std::move(a));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!ok) { // crashed, out of memory or stuck: replace the worker.
+            MKINT_WARN() << "SMT worker " << w.pid << " died or timed out; restarting it";
+            stop(w);
+            ++m_n_restarts;
+            spawn(w);
+        }
+        m_idle.push_back(idx);
+    }
+    m_cv.notify_one();
+    return reply;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <z3++.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mkint {
+
+struct worker_reply {
+    // value of a constant, or of an uninterpreted function applied to `args`.
+    struct assignment {
+        std::string name;
+        unsigned bits; // 0 for booleans.
+        std::string value; // a decimal numeral, `true` or `false`.
+        std::vector<std::string> args;
+    };
+
+    z3::check_result verdict = z3::unknown;
+    std::vector<assignment> model; // only filled for sat.
+};
+
+// A pool of forked solver processes. The workers are forked by a fork server, itself forked when the pool is created,
+// so that no fork happens while the host runs other threads; create the pool before starting any. Queries are sent as SMT-LIB2 text over a socket, so a crash, an assertion or
+// a memory blow-up in the solver only kills the worker: it is restarted and the query is answered unknown.
+// `solve` may be called from several threads; each call occupies one worker.
+class solver_pool {
+public:
+    // `mem_limit` is the address space (MiB) a worker may map beyond what it inherits from the host; 0 means no limit.
+    solver_pool(unsigned n_workers, unsigned mem_limit, unsigned rlimit);
+    solver_pool(const solver_pool&) = delete;
+    solver_pool& operator=(const solver_pool&) = delete;
+    ~solver_pool();
+
+    // `timeout` (ms) is enforced by the worker; a worker not answering well after it is killed. 0 means no limit.
+    worker_reply solve(const std::string& smt2, unsigned timeout);
+
+    size_t size() const { return m_workers.size(); }
+    size_t n_restarts() const { return m_n_restarts; }
+
+private:
+    struct worker {
+        int pid = -1;
+        int fd = -1;
+    };
+
+    bool spawn(worker& w);
+    void stop(worker& w);
+
+    int m_server_pid = -1;
+    int m_server_fd = -1; // requests to the fork server: under `m_mutex`.
+    std::vector<worker> m_workers;
+    std::vector<size_t> m_idle;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    size_t m_n_restarts = 0;
+}; // class solver_pool
+
+} // namespace mkint
@@ -0,0 +1,19 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -S %s -o %t.O0.ll
+// RUN: opt-14 -passes=mem2reg -S %t.O0.ll -o %t.ll
+// RUN: opt-14 -load-pass-plugin=%builddir/mkint/MiniKintPass.so -passes=mkint-pass -S %t.ll -o %t.out.ll
+
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_IR_correct
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_i_annoted
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static void* helper(uint32_t x)
+{
+    // the range of `x` is empty until the call below is analyzed: the branch must not stay dead after that round.
+    if (x < 10)
+        return NULL;
+    return malloc(x * 16);
+}
+
+void* sys_foo(uint32_t n) { return helper(n); }
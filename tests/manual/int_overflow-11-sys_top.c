@@ -0,0 +1,26 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -S %s -o %t.O0.ll
+// RUN: opt-14 -passes=mem2reg -S %t.O0.ll -o %t.ll
+// RUN: timeout 60 opt-14 -load=%builddir/mkint/MiniKintPass.so -load-pass-plugin=%builddir/mkint/MiniKintPass.so -passes=mkint-pass -mkint-smt-budget=2000 -S %t.ll -o %t.out.ll
+
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_IR_correct
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_i_annoted
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// products of two 32-bit primes: deciding a branch on one is factoring it, which spends any budget.
+#define SEMIPRIME_1 12853060756714082521ULL
+#define SEMIPRIME_2 11103144456656479789ULL
+
+// the riskiest check of the module: it must be solved before exploring `sys_hard` exhausts the budget.
+void* sys_top(uint64_t n) { return malloc(n * 16); }
+
+void* sys_hard(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint64_t y, uint64_t z)
+{
+    uint64_t x = y ^ z;
+    if ((uint64_t)a * b == SEMIPRIME_1)
+        x = 0;
+    if ((uint64_t)c * d == SEMIPRIME_2)
+        x = 1;
+    return malloc(x);
+}
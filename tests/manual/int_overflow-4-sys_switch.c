@@ -0,0 +1,26 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -S %s -o %t.ll
+// RUN: opt-14 -load-pass-plugin=%builddir/mkint/MiniKintPass.so -passes=mkint-pass -S %t.ll -o %t.out.ll
+
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_IR_correct
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_i_annoted
+
+#include <stdint.h>
+#include <stdlib.h>
+
+void* sys_switch(uint32_t c)
+{
+    uint32_t n;
+    switch (c) {
+    case 0:
+    case 1:
+    case 2:
+        n = c * 0x80000000u; // only overflows for the last case.
+        break;
+    case 5:
+        n = 1;
+        break;
+    default:
+        return NULL;
+    }
+    return malloc(n);
+}
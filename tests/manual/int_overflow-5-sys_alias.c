@@ -0,0 +1,18 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -S %s -o %t.ll
+// RUN: opt-14 -load-pass-plugin=%builddir/mkint/MiniKintPass.so -passes=mkint-pass -S %t.ll -o %t.out.ll
+
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_IR_correct
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_i_annoted
+
+#include <stdint.h>
+#include <stdlib.h>
+
+void* sys_alias(uint32_t* p, uint32_t* q)
+{
+    // two loads of the same kind: one solver symbol for both would bound `b` by the check of `a`.
+    uint32_t a = *p;
+    uint32_t b = *q;
+    if (a > 1000)
+        return NULL;
+    return malloc(b * 16);
+}
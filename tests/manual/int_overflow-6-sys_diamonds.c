@@ -0,0 +1,23 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -S %s -o %t.ll
+// RUN: timeout 60 opt-14 -load-pass-plugin=%builddir/mkint/MiniKintPass.so -passes=mkint-pass -S %t.ll -o %t.out.ll
+
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_IR_correct
+// RUN: BEFORE=%t.ll AFTER=%t.out.ll python3 %testdir/llvm_lite.py TestMKint.test_i_annoted
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static unsigned long stats;
+
+#define COUNT(i)     \
+    if (flags[i])    \
+        stats++;
+
+void* sys_diamonds(uint32_t n, const uint8_t* flags)
+{
+    // both arms of every diamond reach the next one with the same state for `n`: without pruning, the allocation is
+    // reached on 2^16 paths.
+    COUNT(0) COUNT(1) COUNT(2) COUNT(3) COUNT(4) COUNT(5) COUNT(6) COUNT(7)
+    COUNT(8) COUNT(9) COUNT(10) COUNT(11) COUNT(12) COUNT(13) COUNT(14) COUNT(15)
+    return malloc(n * 16);
+}
@@ -0,0 +1,17 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -c -DTU_SOURCE %s -o %t.src.bc
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -c %s -o %t.caller.bc
+// RUN: %builddir/mkint/mkint-driver -thin %t.src.bc %t.caller.bc | FileCheck %s
+
+// The caller's module only declares the source: it is summarized and analyzed without marking it.
+// CHECK: src.bc: sys_cb: integer overflow:
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef TU_SOURCE
+void* sys_cb(uint32_t n) { return malloc(n * 16); }
+#else
+void* sys_cb(uint32_t n);
+
+void* kernel_fn(uint32_t n) { return sys_cb(n); }
+#endif
@@ -0,0 +1,12 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -emit-llvm -c %s -o %t.bc
+// RUN: %builddir/mkint/mkint-driver -separate %t.bc | FileCheck %s
+
+// The return value of a source flows into an allocation in its caller, which lazy loading must keep.
+// CHECK: sys_cb: integer overflow:
+
+#include <stdint.h>
+#include <stdlib.h>
+
+uint32_t sys_cb(uint32_t x) { return x * 1000; }
+
+void* kernel_fn(uint32_t n) { return malloc(sys_cb(n)); }
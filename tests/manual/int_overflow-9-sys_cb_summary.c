@@ -0,0 +1,17 @@
+// RUN: clang-14 -O0 -Xclang -disable-O0-optnone -flto=thin -c %s -o %t.bc
+// RUN: %builddir/mkint/mkint-driver -separate %t.bc 2>&1 | FileCheck %s
+
+// With the ThinLTO summary index in the bitcode, the callers of the source are found without reading any body: the
+// unrelated one is never materialized.
+// CHECK: sys_cb: integer overflow:
+// CHECK: 1 function bodies not reachable from taint sources were not materialized
+// CHECK-NOT: dropped after parsing
+
+#include <stdint.h>
+#include <stdlib.h>
+
+uint32_t sys_cb(uint32_t x) { return x * 1000; }
+
+void* kernel_fn(uint32_t n) { return malloc(sys_cb(n)); }
+
+uint32_t unrelated(uint32_t x) { return x + 1; }